@@ -0,0 +1,268 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+//Batches still to walk, for a checkpoint.  Everything below next_batch that
+//is not in ranges has been walked.
+struct walk_snapshot
+{
+  uint64_t next_batch;
+  uint64_t done;
+  std::vector<std::pair<uint64_t, uint64_t>> ranges;  //[first, last)
+};
+
+//------------------------------------------------------------------------------
+//
+//batch_scheduler hands out the batches of a key-space walk.  Batch b always
+//covers the same keys, so what gets checked does not depend on which thread
+//checks it.  Each thread owns a range of batches and takes them from the
+//front.  One that runs dry takes a range left over from a checkpoint, then a
+//new chunk of the walk, or once the walk is all handed out, steals the back
+//half of the largest range left.  Faster threads end up doing more of the
+//batches.
+//
+//Threads taking batches share snapshot_lock, which snapshot takes alone so
+//that it sees no batch half moved.  Range locks are taken in index order and
+//the leftover lock after them.  Keep a global instance so that the ranges get
+//their alignment.
+//
+//------------------------------------------------------------------------------
+template <size_t max_threads>
+class batch_scheduler
+{
+public:
+  batch_scheduler() : num_ranges(0), next_batch(0), last_batch(0), chunk(1), total(0), done(0), steals(0), walking(false) {}
+
+  batch_scheduler(const batch_scheduler&) = delete;
+  batch_scheduler& operator=(const batch_scheduler&) = delete;
+
+  //Only while no thread is taking batches.  A bounded walk of num_batches is
+  //split evenly over the threads up front, an unbounded one (0) is handed out
+  //a_chunk batches at a time.
+  void start(uint32_t num_threads, uint64_t num_batches, uint32_t a_chunk)
+  {
+    reset(num_threads, num_batches, a_chunk);
+    if (num_batches != 0)
+    {
+      for (uint32_t i=0; i<num_threads; i++)
+      {
+        ranges[i].begin = num_batches * i / num_threads;
+        ranges[i].end   = num_batches * (i + 1) / num_threads;
+      }
+    }
+    walking = true;
+  }
+
+  //Same, carrying on from a snapshot of a walk with the same batches
+  void restore(uint32_t num_threads, uint64_t num_batches, uint32_t a_chunk, const walk_snapshot& snapshot)
+  {
+    reset(num_threads, num_batches, a_chunk);
+    if (num_batches == 0) next_batch = snapshot.next_batch;
+    leftovers = snapshot.ranges;
+    done      = snapshot.done;
+    walking   = true;
+  }
+
+  void stop() { walking = false; }
+
+  //Threads added to a running walk start empty and steal.  Removed threads
+  //keep their range for the others to steal.
+  void add_threads(uint32_t num_threads)
+  {
+    if (num_threads > num_ranges) num_ranges = num_threads;
+  }
+
+  //Returns false when there is nothing left to take
+  bool next(uint32_t thread_num, uint64_t& batch)
+  {
+    boost::shared_lock<boost::shared_mutex> shared(snapshot_lock);
+    batch_range & own = ranges[thread_num];
+    {
+      boost::lock_guard<boost::mutex> lock(own.lock);
+      if (own.begin >= own.end && !take_leftover(own))
+      {
+        uint64_t first = next_batch.fetch_add(chunk, std::memory_order_relaxed);
+        if (first < last_batch)
+        {
+          own.begin = first;
+          own.end   = std::min<uint64_t>(first + chunk, last_batch);
+        }
+      }
+      if (own.begin < own.end)
+      {
+        batch = take_front(own);
+        return true;
+      }
+    }
+    return steal(thread_num, batch);
+  }
+
+  void batch_done(uint32_t thread_num)
+  {
+    boost::shared_lock<boost::shared_mutex> shared(snapshot_lock);
+    boost::lock_guard<boost::mutex> lock(ranges[thread_num].lock);
+    ranges[thread_num].busy = false;
+    done.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  //Consistent while threads are taking batches.  A batch being walked counts
+  //as not walked.
+  walk_snapshot snapshot()
+  {
+    boost::unique_lock<boost::shared_mutex> exclusive(snapshot_lock);
+    walk_snapshot result;
+    result.next_batch = std::min<uint64_t>(next_batch, last_batch);
+    result.done       = done;
+    {
+      boost::lock_guard<boost::mutex> lock(leftover_lock);
+      result.ranges = leftovers;
+    }
+    for (batch_range & x : ranges)
+    {
+      boost::lock_guard<boost::mutex> lock(x.lock);
+      if (x.busy)           result.ranges.push_back(std::make_pair(x.in_flight, x.in_flight + 1));
+      if (x.begin < x.end)  result.ranges.push_back(std::make_pair(x.begin, x.end));
+    }
+    return result;
+  }
+
+  bool     active()          const { return walking; }
+  bool     finished()        const { return walking && total.load() != 0 && done.load(std::memory_order_relaxed) >= total.load(); }
+  uint64_t num_batches()     const { return total; }  //0 if unbounded
+  uint64_t batches_done()    const { return done.load(std::memory_order_relaxed); }
+  uint64_t batches_stolen()  const { return steals.load(std::memory_order_relaxed); }
+
+private:
+  struct alignas(64) batch_range
+  {
+    boost::mutex lock;
+    uint64_t     begin;
+    uint64_t     end;
+    uint64_t     in_flight;  //Taken by the owner and not done yet, if busy
+    bool         busy;
+  };
+
+  void reset(uint32_t num_threads, uint64_t num_batches, uint32_t a_chunk)
+  {
+    for (batch_range & x : ranges)
+    {
+      x.begin = x.end = 0;
+      x.busy  = false;
+    }
+    leftovers.clear();
+    num_ranges = num_threads;
+    chunk      = a_chunk;
+    total      = num_batches;
+    done       = 0;
+    steals     = 0;
+    next_batch = (num_batches == 0) ? 0 : num_batches;
+    last_batch = (num_batches == 0) ? std::numeric_limits<uint64_t>::max() : num_batches;
+  }
+
+  //With the range's lock held
+  uint64_t take_front(batch_range& x)
+  {
+    x.in_flight = x.begin++;
+    x.busy      = true;
+    return x.in_flight;
+  }
+
+  //With own's lock held
+  bool take_leftover(batch_range& own)
+  {
+    boost::lock_guard<boost::mutex> lock(leftover_lock);
+    if (leftovers.empty()) return false;
+    own.begin = leftovers.back().first;
+    own.end   = leftovers.back().second;
+    leftovers.pop_back();
+    return true;
+  }
+
+  bool steal(uint32_t thread_num, uint64_t& batch)
+  {
+    while (true)
+    {
+      uint32_t victim  = 0;
+      uint64_t largest = 0;
+      uint32_t count   = num_ranges;
+      for (uint32_t i=0; i<count; i++)
+      {
+        if (i == thread_num) continue;
+        boost::lock_guard<boost::mutex> lock(ranges[i].lock);
+        uint64_t left = ranges[i].end - ranges[i].begin;
+        if (left > largest)
+        {
+          largest = left;
+          victim  = i;
+        }
+      }
+      if (largest == 0) return false;
+
+      //Both held, so the stolen batches are never in neither range
+      batch_range & own  = ranges[thread_num];
+      batch_range & from = ranges[victim];
+      boost::unique_lock<boost::mutex> first_lock(thread_num < victim ? own.lock : from.lock);
+      boost::unique_lock<boost::mutex> second_lock(thread_num < victim ? from.lock : own.lock);
+      uint64_t left = from.end - from.begin;
+      if (left == 0) continue;  //Taken meanwhile, look again
+
+      own.end   = from.end;
+      own.begin = from.end - (left + 1) / 2;
+      from.end  = own.begin;
+      steals.fetch_add(1, std::memory_order_relaxed);
+      batch = take_front(own);
+      return true;
+    }
+  }
+
+  batch_range           ranges[max_threads];
+  std::atomic<uint32_t> num_ranges;
+  alignas(64) std::atomic<uint64_t> next_batch;
+  uint64_t              last_batch;
+  uint32_t              chunk;
+  std::atomic<uint64_t> total;
+  alignas(64) std::atomic<uint64_t> done;
+  std::atomic<uint64_t> steals;
+  std::atomic<bool>     walking;
+  boost::shared_mutex   snapshot_lock;
+  boost::mutex          leftover_lock;
+  std::vector<std::pair<uint64_t, uint64_t>> leftovers;
+};
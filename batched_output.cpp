@@ -0,0 +1,122 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "batched_output.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+
+bool batched_output::open(const std::string& filename, bool truncate, mode_t mode)
+{
+  close();
+  fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | (truncate ? O_TRUNC : 0), mode);
+  return fd >= 0;
+}
+
+//------------------------------------------------------------------------------
+
+uint64_t batched_output::file_size() const
+{
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) return 0;
+  return st.st_size;
+}
+
+//------------------------------------------------------------------------------
+
+bool batched_output::truncate_to(uint64_t size)
+{
+  buffer.clear();
+  pending_records = 0;
+  return fd >= 0 && ftruncate(fd, size) == 0;
+}
+
+//------------------------------------------------------------------------------
+
+void batched_output::add(const std::string& record, bool a_urgent)
+{
+  buffer += record;
+  pending_records++;
+  urgent = urgent || a_urgent;
+}
+
+//------------------------------------------------------------------------------
+
+bool batched_output::flush_if_due(const durability_policy& policy, int64_t now_ms)
+{
+  if (pending_records == 0) return true;
+  if (waiting_since_ms == 0) waiting_since_ms = now_ms;
+
+  bool due = urgent
+          || (policy.flush_records == 0 && policy.flush_ms == 0)
+          || (policy.flush_records != 0 && pending_records >= policy.flush_records)
+          || (policy.flush_ms != 0 && now_ms - waiting_since_ms >= policy.flush_ms);
+  return !due || flush(policy.fsync || urgent);
+}
+
+//------------------------------------------------------------------------------
+
+bool batched_output::flush(bool sync)
+{
+  if (fd < 0) return false;
+
+  size_t done = 0;
+  while (done < buffer.size())
+  {
+    ssize_t n = ::write(fd, buffer.data() + done, buffer.size() - done);
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      buffer.erase(0, done);  //Keep the rest for the next try
+      return false;
+    }
+    done += n;
+  }
+  buffer.clear();
+  pending_records  = 0;
+  urgent           = false;
+  waiting_since_ms = 0;
+  return !sync || ::fsync(fd) == 0;
+}
+
+//------------------------------------------------------------------------------
+
+void batched_output::close(bool sync)
+{
+  if (fd < 0) return;
+  flush(sync);
+  ::close(fd);
+  fd = -1;
+  buffer.clear();
+  pending_records  = 0;
+  urgent           = false;
+  waiting_since_ms = 0;
+}
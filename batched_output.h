@@ -0,0 +1,85 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+//When buffered records go to disk.  With no count or time trigger they are
+//written every time the writer has drained the match queue.
+struct durability_policy
+{
+  uint32_t flush_records;  //Write once this many records are waiting, 0 = no count trigger
+  uint32_t flush_ms;       //Write once the oldest record has waited this long, 0 = no time trigger
+  bool     fsync;          //fsync after every write
+  uint32_t sync_length;    //Words at least this long are written and synced at the next check, 0 = off
+};
+
+//------------------------------------------------------------------------------
+//
+//batched_output appends text records to a file through a buffer, writing
+//them in one write() when the policy says so instead of one stream flush per
+//record.  Only one thread may use it at a time.
+//
+//------------------------------------------------------------------------------
+class batched_output
+{
+public:
+  batched_output() : fd(-1), pending_records(0), urgent(false), waiting_since_ms(0) {}
+  ~batched_output() { close(); }
+
+  batched_output(const batched_output&) = delete;
+  batched_output& operator=(const batched_output&) = delete;
+
+  bool open(const std::string& filename, bool truncate, mode_t mode = 0666);  //mode if the file is created
+  bool is_open() const { return fd >= 0; }
+  uint64_t file_size() const;  //On disk, not counting what is buffered
+
+  //Cuts the file back to size bytes, dropping anything buffered
+  bool truncate_to(uint64_t size);
+
+  //An urgent record is written and synced at the next flush_if_due
+  void add(const std::string& record, bool a_urgent);
+  size_t pending() const { return pending_records; }
+
+  //Returns false if a write failed
+  bool flush_if_due(const durability_policy& policy, int64_t now_ms);
+  bool flush(bool sync);
+
+  //Writes what is left first
+  void close(bool sync = false);
+
+private:
+  int         fd;
+  std::string buffer;
+  size_t      pending_records;
+  bool        urgent;
+  int64_t     waiting_since_ms;  //When the oldest waiting record was first seen by flush_if_due, 0 if none
+};
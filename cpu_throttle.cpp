@@ -0,0 +1,101 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cpu_throttle.h"
+#include <fstream>
+#include <time.h>
+
+#define DUTY_WINDOW_SECONDS 60
+
+//------------------------------------------------------------------------------
+
+double thread_cpu_seconds()
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------------
+
+double process_cpu_seconds()
+{
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+  timespec ts;
+  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0) return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------------
+
+bool read_load_average(double& load)
+{
+  std::ifstream loadavg("/proc/loadavg");
+  return loadavg.is_open() && (loadavg >> load);
+}
+
+//------------------------------------------------------------------------------
+
+void duty_cycle::restart()
+{
+  started    = true;
+  start_cpu  = thread_cpu_seconds();
+  start_wall = clock::now();
+}
+
+//------------------------------------------------------------------------------
+
+double duty_cycle::pause_for(double duty, double max_pause)
+{
+  if (duty >= 1)
+  {
+    started = false;
+    return 0;
+  }
+  if (!started)
+  {
+    restart();
+    return 0;
+  }
+
+  double cpu  = thread_cpu_seconds() - start_cpu;
+  double wall = std::chrono::duration<double>(clock::now() - start_wall).count();
+
+  if (wall > DUTY_WINDOW_SECONDS)
+  {
+    start_cpu  += cpu / 2;
+    start_wall += std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(wall / 2));
+  }
+
+  double owed = cpu / duty - wall;
+  if (owed <= 0) return 0;
+  return owed < max_pause ? owed : max_pause;
+}
@@ -0,0 +1,70 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <chrono>
+
+//CPU time used by the calling thread, in seconds.  Falls back to wall time
+//where there is no per-thread CPU clock.
+double thread_cpu_seconds();
+
+//CPU time used by all threads of the process, same fallback
+double process_cpu_seconds();
+
+//1-minute load average from /proc/loadavg
+bool read_load_average(double& load);
+
+//------------------------------------------------------------------------------
+//
+//duty_cycle keeps one thread's CPU time at a fraction of wall time.  It is
+//asked after each batch how long to sleep; the answer comes from measured
+//CPU time so it adapts to however long batches really take.  History older
+//than about DUTY_WINDOW_SECONDS is halved away so a change of duty settles
+//within a window.  A change of duty keeps the history and only moves the
+//target, so a duty that wobbles with the load average still averages out.
+//The history starts afresh after running unthrottled.
+//
+//------------------------------------------------------------------------------
+class duty_cycle
+{
+public:
+  duty_cycle() : started(false), start_cpu(0) {}
+
+  //Seconds to sleep now, at most max_pause
+  double pause_for(double duty, double max_pause);
+
+private:
+  typedef std::chrono::steady_clock clock;
+
+  void restart();
+
+  bool              started;
+  double            start_cpu;
+  clock::time_point start_wall;
+};
@@ -0,0 +1,339 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "cpu_topology.h"
+#include "number_list.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <tuple>
+#include <map>
+#include <cmath>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static const std::string cpu_sysfs_dir  = "/sys/devices/system/cpu/";
+static const std::string node_sysfs_dir = "/sys/devices/system/node/";
+static const std::string cgroup_dir     = "/sys/fs/cgroup";
+
+//--------------------------------------------------------------------------------
+//Kernel cpulist format, e.g. "0-3,8-11".  No CPU past what a cpu_set_t holds.
+bool parse_cpu_list(const std::string& cpu_list, std::vector<uint32_t>& cpus)
+{
+  std::string trimmed = boost::trim_copy(cpu_list);
+  if (trimmed.empty()) return true;
+  return parse_number_list(trimmed, MAX_CPU_ID, cpus);
+}
+//--------------------------------------------------------------------------------
+bool parse_placement(const std::string& arg, placement_policy& policy, std::vector<uint32_t>& cpus)
+{
+  std::string name = boost::to_lower_copy(arg);
+  cpus.clear();
+  if      (name == "none")     policy = placement_policy::none;
+  else if (name == "compact")  policy = placement_policy::compact;
+  else if (name == "scatter")  policy = placement_policy::scatter;
+  else if (name == "physical") policy = placement_policy::physical;
+  else if (!name.empty() && isdigit(name[0]) && parse_cpu_list(name, cpus) && !cpus.empty())
+  {
+    policy = placement_policy::list;
+  }
+  else return false;
+  return true;
+}
+//--------------------------------------------------------------------------------
+std::string placement_name(placement_policy policy)
+{
+  switch (policy)
+  {
+    case placement_policy::none:     return "none";
+    case placement_policy::compact:  return "compact";
+    case placement_policy::scatter:  return "scatter";
+    case placement_policy::physical: return "physical";
+    case placement_policy::list:     return "list";
+  }
+  return "";
+}
+//--------------------------------------------------------------------------------
+static bool read_sysfs_value(const std::string& path, uint32_t& value)
+{
+  std::ifstream in(path);
+  return in.is_open() && (in >> value);
+}
+//--------------------------------------------------------------------------------
+static bool read_sysfs_list(const std::string& path, std::vector<uint32_t>& values)
+{
+  std::ifstream in(path);
+  std::string line;
+  return in.is_open() && getline(in, line) && parse_cpu_list(line, values);
+}
+//--------------------------------------------------------------------------------
+//Drops the CPUs outside the process affinity mask, as threads can't be
+//pinned to them
+static void keep_allowed_cpus(std::vector<uint32_t>& cpus)
+{
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) return;
+  cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&](uint32_t cpu) { return cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &cpu_set); }),
+             cpus.end());
+#endif
+}
+//--------------------------------------------------------------------------------
+//Online CPUs in the affinity mask with their socket, core and NUMA node.
+//Empty if sysfs isn't there.
+std::vector<cpu_info> read_cpu_topology()
+{
+  std::vector<cpu_info> topology;
+  std::vector<uint32_t> cpus;
+  if (!read_sysfs_list(cpu_sysfs_dir + "online", cpus)) return topology;
+  keep_allowed_cpus(cpus);
+
+  std::map<uint32_t, uint32_t> cpu_nodes;
+  std::vector<uint32_t> nodes;
+  read_sysfs_list(node_sysfs_dir + "online", nodes);
+  for (uint32_t node : nodes)
+  {
+    std::vector<uint32_t> node_cpus;
+    read_sysfs_list(node_sysfs_dir + "node" + std::to_string(node) + "/cpulist", node_cpus);
+    for (uint32_t cpu : node_cpus) cpu_nodes[cpu] = node;
+  }
+
+  for (uint32_t cpu : cpus)
+  {
+    std::string topology_dir = cpu_sysfs_dir + "cpu" + std::to_string(cpu) + "/topology/";
+    cpu_info info {cpu, 0, cpu, 0, cpu_nodes.count(cpu) ? cpu_nodes[cpu] : 0};
+    read_sysfs_value(topology_dir + "physical_package_id", info.package);
+    read_sysfs_value(topology_dir + "core_id", info.core);
+    topology.push_back(info);
+  }
+
+  //Number the hardware threads of each core in CPU order
+  std::map<std::pair<uint32_t, uint32_t>, uint32_t> threads_per_core;
+  for (cpu_info & x : topology) x.smt_index = threads_per_core[std::make_pair(x.package, x.core)]++;
+  return topology;
+}
+//--------------------------------------------------------------------------------
+//The CPU for each worker in order, only from those the process may run on.
+//Workers beyond the end wrap around.
+std::vector<uint32_t> placement_cpus(placement_policy policy, const std::vector<cpu_info>& topology, const std::vector<uint32_t>& explicit_cpus)
+{
+  if (policy == placement_policy::list)
+  {
+    std::vector<uint32_t> cpus(explicit_cpus);
+    keep_allowed_cpus(cpus);
+    return cpus;
+  }
+
+  std::vector<cpu_info> order(topology);
+  //Rank of each core within its package, so that scatter can interleave packages
+  std::map<std::pair<uint32_t, uint32_t>, uint32_t> core_rank;
+  std::map<uint32_t, uint32_t> cores_per_package;
+  for (const cpu_info & x : order)
+  {
+    if (x.smt_index == 0) core_rank[std::make_pair(x.package, x.core)] = cores_per_package[x.package]++;
+  }
+  auto rank = [&](const cpu_info& x) { return core_rank[std::make_pair(x.package, x.core)]; };
+
+  switch (policy)
+  {
+    case placement_policy::compact:
+      std::stable_sort(order.begin(), order.end(), [&](const cpu_info& a, const cpu_info& b) {
+        return std::make_tuple(a.package, rank(a), a.smt_index) < std::make_tuple(b.package, rank(b), b.smt_index); });
+      break;
+    case placement_policy::scatter:
+      std::stable_sort(order.begin(), order.end(), [&](const cpu_info& a, const cpu_info& b) {
+        return std::make_tuple(a.smt_index, rank(a), a.package) < std::make_tuple(b.smt_index, rank(b), b.package); });
+      break;
+    case placement_policy::physical:
+      std::stable_sort(order.begin(), order.end(), [&](const cpu_info& a, const cpu_info& b) {
+        return std::make_tuple(a.smt_index, a.package, rank(a)) < std::make_tuple(b.smt_index, b.package, rank(b)); });
+      break;
+    default:
+      return std::vector<uint32_t>();
+  }
+
+  std::vector<uint32_t> cpus;
+  for (const cpu_info & x : order) cpus.push_back(x.cpu);
+  return cpus;
+}
+//--------------------------------------------------------------------------------
+//Controller -> path of this process's cgroup, from /proc/self/cgroup.  The
+//cgroup v2 hierarchy is listed under "".
+static std::map<std::string, std::string> read_proc_cgroups()
+{
+  std::map<std::string, std::string> cgroups;
+  std::ifstream in("/proc/self/cgroup");
+  std::string line;
+  while (getline(in, line))
+  {
+    size_t first_colon  = line.find(':');
+    size_t second_colon = line.find(':', first_colon + 1);
+    if (first_colon == std::string::npos || second_colon == std::string::npos) continue;
+
+    std::vector<std::string> controllers;
+    std::string controller_list = line.substr(first_colon + 1, second_colon - first_colon - 1);
+    boost::split(controllers, controller_list, boost::is_any_of(","));
+    for (const std::string & x : controllers) cgroups[x] = line.substr(second_colon + 1);
+  }
+  return cgroups;
+}
+//--------------------------------------------------------------------------------
+//The cgroup directory and its ancestors up to the mount point.  Inside a
+//container the path from /proc/self/cgroup may not exist under the mount
+//point, in which case only the mount point itself is used.
+static std::vector<std::string> cgroup_dirs(const std::string& mount, const std::string& path)
+{
+  std::vector<std::string> dirs;
+  std::string dir = path;
+  while (!dir.empty() && dir != "/")
+  {
+    if (std::ifstream(mount + dir + "/cgroup.procs").is_open()) dirs.push_back(mount + dir);
+    dir = dir.substr(0, dir.rfind('/'));
+  }
+  dirs.push_back(mount);
+  return dirs;
+}
+//--------------------------------------------------------------------------------
+static uint32_t read_cpuset(const std::vector<std::string>& dirs, const std::vector<std::string>& filenames)
+{
+  for (const std::string & dir : dirs)
+  {
+    for (const std::string & filename : filenames)
+    {
+      std::vector<uint32_t> cpus;
+      if (read_sysfs_list(dir + "/" + filename, cpus) && !cpus.empty()) return cpus.size();
+    }
+  }
+  return 0;
+}
+//--------------------------------------------------------------------------------
+//Tightest CPU bandwidth limit along the hierarchy, 0 if there is none
+static double read_cpu_quota(std::map<std::string, std::string>& cgroups)
+{
+  double quota = 0;
+  auto tighten = [&](double limit) { if (limit > 0 && (quota == 0 || limit < quota)) quota = limit; };
+
+  if (std::ifstream(cgroup_dir + "/cgroup.controllers").is_open())
+  {
+    //cgroup v2: cpu.max holds "max <period>" or "<quota> <period>"
+    for (const std::string & dir : cgroup_dirs(cgroup_dir, cgroups[""]))
+    {
+      std::ifstream in(dir + "/cpu.max");
+      std::string max_quota;
+      double period = 0;
+      if (in >> max_quota >> period && max_quota != "max" && period > 0)
+      {
+        try
+        {
+          tighten(boost::lexical_cast<double>(max_quota) / period);
+        }
+        catch(boost::bad_lexical_cast& e) {}
+      }
+    }
+    return quota;
+  }
+
+  //cgroup v1: cpu.cfs_quota_us is -1 when unlimited
+  for (const std::string & mount : {cgroup_dir + "/cpu,cpuacct", cgroup_dir + "/cpu"})
+  {
+    if (!std::ifstream(mount + "/cpu.cfs_period_us").is_open()) continue;
+    for (const std::string & dir : cgroup_dirs(mount, cgroups["cpu"]))
+    {
+      std::ifstream quota_file(dir + "/cpu.cfs_quota_us");
+      std::ifstream period_file(dir + "/cpu.cfs_period_us");
+      double cfs_quota = 0;
+      double period    = 0;
+      if (quota_file >> cfs_quota && period_file >> period && cfs_quota > 0 && period > 0) tighten(cfs_quota / period);
+    }
+    break;
+  }
+  return quota;
+}
+//--------------------------------------------------------------------------------
+cpu_limits read_cpu_limits()
+{
+  cpu_limits limits {0, 0, 0, 0, 0};
+
+  std::vector<uint32_t> cpus;
+  if (read_sysfs_list(cpu_sysfs_dir + "online", cpus)) limits.online = cpus.size();
+  if (limits.online == 0) limits.online = std::thread::hardware_concurrency();
+
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) limits.affinity = CPU_COUNT(&cpu_set);
+
+  std::map<std::string, std::string> cgroups = read_proc_cgroups();
+  if (std::ifstream(cgroup_dir + "/cgroup.controllers").is_open())
+  {
+    limits.cpuset = read_cpuset(cgroup_dirs(cgroup_dir, cgroups[""]), {"cpuset.cpus.effective"});
+  }
+  else
+  {
+    limits.cpuset = read_cpuset(cgroup_dirs(cgroup_dir + "/cpuset", cgroups["cpuset"]), {"cpuset.effective_cpus", "cpuset.cpus"});
+  }
+  limits.quota = read_cpu_quota(cgroups);
+#endif
+
+  limits.effective = limits.online;
+  if (limits.affinity != 0) limits.effective = std::min(limits.effective, limits.affinity);
+  if (limits.cpuset   != 0) limits.effective = std::min(limits.effective, limits.cpuset);
+  if (limits.quota    >  0) limits.effective = std::min(limits.effective, (uint32_t) std::ceil(limits.quota));
+  if (limits.effective == 0) limits.effective = 1;
+  return limits;
+}
+//--------------------------------------------------------------------------------
+bool pin_thread(std::thread& a_thread, uint32_t cpu)
+{
+#ifdef __linux__
+  if (cpu >= CPU_SETSIZE) return false;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  return pthread_setaffinity_np(a_thread.native_handle(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+  return false;
+#endif
+}
+//--------------------------------------------------------------------------------
+//Back to every CPU the process may run on
+bool unpin_thread(std::thread& a_thread)
+{
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) return false;
+  return pthread_setaffinity_np(a_thread.native_handle(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+  return false;
+#endif
+}
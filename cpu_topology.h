@@ -0,0 +1,80 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#define MAX_CPU_ID (CPU_SETSIZE - 1)
+#else
+#define MAX_CPU_ID 1023
+#endif
+
+struct cpu_info
+{
+  uint32_t cpu;
+  uint32_t package;    //Socket
+  uint32_t core;       //core_id, only unique within a package
+  uint32_t smt_index;  //0 for the first hardware thread of a core, 1 for its sibling...
+  uint32_t node;       //NUMA node, 0 without NUMA
+};
+
+enum class placement_policy
+{
+  none,      //Leave placement to the kernel
+  compact,   //Fill a core's hardware threads, then the next core, then the next socket
+  scatter,   //Spread over sockets and cores, hardware thread siblings last
+  physical,  //One thread per physical core socket by socket, then the siblings
+  list       //Explicit list of CPUs
+};
+
+bool parse_cpu_list(const std::string& cpu_list, std::vector<uint32_t>& cpus);
+bool parse_placement(const std::string& arg, placement_policy& policy, std::vector<uint32_t>& cpus);
+std::string placement_name(placement_policy policy);
+
+std::vector<cpu_info> read_cpu_topology();
+std::vector<uint32_t> placement_cpus(placement_policy policy, const std::vector<cpu_info>& topology, const std::vector<uint32_t>& explicit_cpus);
+
+//CPUs the process can really use, after affinity and cgroup (v1 or v2) limits
+struct cpu_limits
+{
+  uint32_t online;     //Online CPUs
+  uint32_t affinity;   //CPUs in the process affinity mask
+  uint32_t cpuset;     //CPUs in the cgroup cpuset, 0 if unknown
+  double   quota;      //CPUs worth of cgroup CPU bandwidth, 0 if unlimited
+  uint32_t effective;  //Smallest of the above, rounded up, at least 1
+};
+
+cpu_limits read_cpu_limits();
+
+bool pin_thread(std::thread& a_thread, uint32_t cpu);
+bool unpin_thread(std::thread& a_thread);
@@ -0,0 +1,253 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "index_cache.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+//--------------------------------------------------------------------------------
+static void put_le(std::string& out, uint64_t value, size_t bytes)
+{
+  for (size_t i=0; i<bytes; i++) out += (char) ((value >> (8*i)) & 0xff);
+}
+//--------------------------------------------------------------------------------
+static uint64_t get_le(const unsigned char* in, size_t bytes)
+{
+  uint64_t value = 0;
+  for (size_t i=0; i<bytes; i++) value |= ((uint64_t) in[i]) << (8*i);
+  return value;
+}
+//--------------------------------------------------------------------------------
+std::string index_cache_filename(const std::string& directory, uint64_t source_hash, const index_params& params)
+{
+  std::stringstream ss;
+  ss << directory << "/" << std::hex << source_hash << std::dec << "-" << params.key_length << "-" << params.min_start_pos
+     << "-" << params.max_start_pos << "-" << params.default_quota << "-" << params.max_position << ".idx";
+  return ss.str();
+}
+//--------------------------------------------------------------------------------
+bool save_index_cache(const std::string& directory, const word_index& index, const index_params& params)
+{
+  mkdir(directory.c_str(), 0777);
+  std::string filename      = index_cache_filename(directory, index.source_hash, params);
+  std::string temp_filename = filename + ".tmp";
+  std::ofstream out(temp_filename, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) return false;
+
+  std::string header(INDEX_CACHE_MAGIC, 8);
+  put_le(header, INDEX_CACHE_VERSION, 4);
+  put_le(header, params.key_length, 4);
+  put_le(header, params.min_start_pos, 4);
+  put_le(header, params.max_start_pos, 4);
+  put_le(header, params.default_quota, 4);
+  put_le(header, index.positions.size(), 4);
+  put_le(header, index.source_hash, 8);
+  put_le(header, index.words->size(), 8);
+  put_le(header, params.max_position, 4);
+  header.resize(INDEX_CACHE_HEADER_SIZE, '\0');
+
+  //Sections are built one at a time, their offsets go in front of them
+  std::vector<std::string> tables(index.positions.size());
+  uint64_t offset = INDEX_CACHE_HEADER_SIZE + 8 * (index.positions.size() + 1);
+  std::string offsets;
+  for (size_t pos=0; pos<index.positions.size(); pos++)
+  {
+    put_le(offsets, offset, 8);
+    std::string & table = tables[pos];
+    put_le(table, index.positions[pos].size(), 8);
+    for (const auto & bucket : index.positions[pos])
+    {
+      table += bucket.first;
+      put_le(table, bucket.second.size(), 4);
+      for (uint32_t id : bucket.second) put_le(table, id, 4);
+    }
+    offset += table.size();
+  }
+  put_le(offsets, offset, 8);
+
+  out.write(header.data(), header.size());
+  out.write(offsets.data(), offsets.size());
+  for (std::string & table : tables)
+  {
+    out.write(table.data(), table.size());
+    std::string().swap(table);
+  }
+  std::string words;
+  for (const word_entry & x : *index.words)
+  {
+    put_le(words, x.quota, 4);
+    put_le(words, x.word.length(), 4);
+    words += x.word;
+  }
+  out.write(words.data(), words.size());
+  out.close();
+
+  if (!out || std::rename(temp_filename.c_str(), filename.c_str()) != 0)
+  {
+    std::remove(temp_filename.c_str());
+    return false;
+  }
+  return true;
+}
+//--------------------------------------------------------------------------------
+//Fills the tables of the positions p with p % num_threads == thread_num.
+//Clears ok if a table doesn't parse.
+static void load_tables(const unsigned char* data, const std::vector<uint64_t>& offsets, uint32_t key_length, uint64_t num_words,
+                        uint32_t thread_num, uint32_t num_threads, word_index& index, std::atomic<bool>& ok)
+{
+  for (size_t pos=thread_num; pos<index.positions.size() && ok; pos+=num_threads)
+  {
+    const unsigned char* in  = data + offsets[pos];
+    const unsigned char* end = data + offsets[pos + 1];
+    if (end - in < 8)
+    {
+      ok = false;
+      return;
+    }
+    uint64_t num_keys = get_le(in, 8);
+    in += 8;
+    if ((uint64_t) (end - in) / (key_length + 4) < num_keys)
+    {
+      ok = false;
+      return;
+    }
+
+    position_table & table = index.positions[pos];
+    table.reserve(num_keys);
+    for (uint64_t i=0; i<num_keys; i++)
+    {
+      if ((uint64_t) (end - in) < key_length + 4)
+      {
+        ok = false;
+        return;
+      }
+      std::string key((const char*) in, key_length);
+      uint64_t    num_ids = get_le(in + key_length, 4);
+      in += key_length + 4;
+      if ((uint64_t) (end - in) < 4 * num_ids)
+      {
+        ok = false;
+        return;
+      }
+
+      std::vector<uint32_t> ids(num_ids);
+      for (uint32_t & id : ids)
+      {
+        id  = get_le(in, 4);
+        in += 4;
+        if (id >= num_words) ok = false;
+      }
+      table.emplace(std::move(key), std::move(ids));
+    }
+  }
+}
+//--------------------------------------------------------------------------------
+std::shared_ptr<word_index> load_index_cache(const std::string& directory, const index_params& params, uint64_t source_hash, uint32_t max_threads)
+{
+  mapped_file file;
+  if (!file.open(index_cache_filename(directory, source_hash, params), false)) return nullptr;
+  const unsigned char* data = (const unsigned char*) file.data();
+  size_t               size = file.size();
+
+  if (size < INDEX_CACHE_HEADER_SIZE
+      || memcmp(data, INDEX_CACHE_MAGIC, 8) != 0
+      || get_le(data + 8,  4) != INDEX_CACHE_VERSION
+      || get_le(data + 12, 4) != params.key_length
+      || get_le(data + 16, 4) != params.min_start_pos
+      || get_le(data + 20, 4) != params.max_start_pos
+      || get_le(data + 24, 4) != params.default_quota
+      || get_le(data + 32, 8) != source_hash
+      || get_le(data + 48, 4) != params.max_position)
+  {
+    return nullptr;
+  }
+  uint64_t num_positions = get_le(data + 28, 4);
+  uint64_t num_words     = get_le(data + 40, 8);
+  if ((size - INDEX_CACHE_HEADER_SIZE) / 8 < num_positions + 1 || size / 8 < num_words) return nullptr;  //Checked before anything is sized from them
+
+  std::vector<uint64_t> offsets(num_positions + 1);
+  for (size_t i=0; i<=num_positions; i++)
+  {
+    offsets[i] = get_le(data + INDEX_CACHE_HEADER_SIZE + 8 * i, 8);
+    uint64_t previous = (i == 0) ? INDEX_CACHE_HEADER_SIZE + 8 * (num_positions + 1) : offsets[i-1];
+    if (offsets[i] < previous || offsets[i] > size) return nullptr;
+  }
+
+  auto index = std::make_shared<word_index>();
+  index->key_length  = params.key_length;
+  index->source_hash = source_hash;
+  index->positions.resize(num_positions);
+
+  std::atomic<bool> ok{true};
+  uint32_t num_threads = std::max<uint64_t>(1, std::min<uint64_t>(std::max<uint32_t>(1, max_threads), num_positions));
+  std::vector<std::thread> threads;
+  for (uint32_t i=1; i<num_threads; i++)
+  {
+    threads.push_back(std::thread(load_tables, data, std::cref(offsets), params.key_length, num_words, i, num_threads, std::ref(*index), std::ref(ok)));
+  }
+
+  //The word list while the other threads fill their tables
+  auto words = std::make_shared<std::vector<word_entry>>();
+  words->reserve(num_words);
+  const unsigned char* in  = data + offsets[num_positions];
+  const unsigned char* end = data + size;
+  for (uint64_t i=0; i<num_words && ok; i++)
+  {
+    if (end - in < 8)
+    {
+      ok = false;
+      break;
+    }
+    uint32_t quota  = get_le(in, 4);
+    uint64_t length = get_le(in + 4, 4);
+    in += 8;
+    if ((uint64_t) (end - in) < length)
+    {
+      ok = false;
+      break;
+    }
+    words->push_back(word_entry {std::string((const char*) in, length), quota});
+    in += length;
+  }
+  load_tables(data, offsets, params.key_length, num_words, 0, num_threads, *index, ok);
+  for (std::thread & x : threads) x.join();
+  if (!ok || in != end) return nullptr;
+
+  index->words      = words;
+  index->word_count = num_words;
+  set_active_positions(*index);
+  return index;
+}
@@ -0,0 +1,66 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "word_index.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//------------------------------------------------------------------------------
+//
+//Compiled word index cache.  An index built from a word file is saved under
+//a name made of the file's hash and the index parameters, and a later load
+//of the same file with the same parameters maps it instead of parsing the
+//file again.
+//
+//  header, 64 bytes: magic, u32 version, u32 key length, u32 min start pos,
+//                    u32 max start pos, u32 default quota, u32 positions,
+//                    u64 source hash, u64 words, u32 last start position,
+//                    zero padding
+//  u64 offset of each position's table, then of the word list
+//  table:     u64 keys, then for each key the key, u32 ids and the ids
+//  word list: for each word u32 quota, u32 length and the word
+//
+//All integers little-endian.  Only whole word lists are cached, words that
+//reached their quota are dropped after loading.
+//
+//------------------------------------------------------------------------------
+#define INDEX_CACHE_MAGIC       "VANITYIX"
+#define INDEX_CACHE_VERSION     2
+#define INDEX_CACHE_HEADER_SIZE 64
+
+std::string index_cache_filename(const std::string& directory, uint64_t source_hash, const index_params& params);
+
+//Creates the directory if needed and writes through a temporary file
+bool save_index_cache(const std::string& directory, const word_index& index, const index_params& params);
+
+//nullptr if there is no cache for the hash and parameters or it is damaged.
+//The tables are rebuilt on up to max_threads threads.
+std::shared_ptr<word_index> load_index_cache(const std::string& directory, const index_params& params, uint64_t source_hash, uint32_t max_threads);
@@ -0,0 +1,190 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "match_format.h"
+#include "match_log.h"
+#include <time.h>
+
+//--------------------------------------------------------------------------------
+static void append_hex(std::string& out, const crypto::secret_key& key)
+{
+  static const char digits[] = "0123456789abcdef";
+  const unsigned char * bytes = reinterpret_cast<const unsigned char *>(&key);
+  for (size_t i=0; i<sizeof(key); i++)
+  {
+    out += digits[bytes[i] >> 4];
+    out += digits[bytes[i] & 0x0f];
+  }
+}
+//--------------------------------------------------------------------------------
+static void append_uint(std::string& out, uint64_t value)
+{
+  char buf[20];
+  size_t n = 0;
+  do
+  {
+    buf[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  while (n > 0) out += buf[--n];
+}
+//--------------------------------------------------------------------------------
+static void append_padded(std::string& out, uint64_t value, size_t width)
+{
+  size_t start = out.size();
+  append_uint(out, value);
+  if (out.size() - start < width) out.insert(start, width - (out.size() - start), '0');
+}
+//--------------------------------------------------------------------------------
+//2017-06-01T12:34:56.789Z
+static void append_timestamp(std::string& out, int64_t unix_ms)
+{
+  time_t seconds = unix_ms / 1000;
+  tm utc;
+  gmtime_r(&seconds, &utc);
+  append_padded(out, utc.tm_year + 1900, 4);  out += '-';
+  append_padded(out, utc.tm_mon + 1, 2);      out += '-';
+  append_padded(out, utc.tm_mday, 2);         out += 'T';
+  append_padded(out, utc.tm_hour, 2);         out += ':';
+  append_padded(out, utc.tm_min, 2);          out += ':';
+  append_padded(out, utc.tm_sec, 2);          out += '.';
+  append_padded(out, unix_ms % 1000, 3);      out += 'Z';
+}
+//--------------------------------------------------------------------------------
+static void append_json_string(std::string& out, const std::string& value)
+{
+  static const char digits[] = "0123456789abcdef";
+  out += '"';
+  for (char c : value)
+  {
+    if (c == '"' || c == '\\')
+    {
+      out += '\\';
+      out += c;
+    }
+    else if ((unsigned char) c < 0x20)
+    {
+      out += "\\u00";
+      out += digits[(c >> 4) & 0x0f];
+      out += digits[c & 0x0f];
+    }
+    else
+    {
+      out += c;
+    }
+  }
+  out += '"';
+}
+//--------------------------------------------------------------------------------
+//Quoted only when it has to be
+static void append_csv_field(std::string& out, const std::string& value)
+{
+  if (value.find_first_of(",\"\r\n") == std::string::npos)
+  {
+    out += value;
+    return;
+  }
+  out += '"';
+  for (char c : value)
+  {
+    if (c == '"') out += '"';
+    out += c;
+  }
+  out += '"';
+}
+//--------------------------------------------------------------------------------
+bool parse_output_format(const std::string& name, output_format& format)
+{
+  if      (name == "text")   format = output_format::text;
+  else if (name == "jsonl")  format = output_format::jsonl;
+  else if (name == "csv")    format = output_format::csv;
+  else if (name == "binary") format = output_format::binary;
+  else return false;
+  return true;
+}
+//--------------------------------------------------------------------------------
+const char* output_format_name(output_format format)
+{
+  switch (format)
+  {
+    case output_format::jsonl:  return "jsonl";
+    case output_format::csv:    return "csv";
+    case output_format::binary: return "binary";
+    default:                    return "text";
+  }
+}
+//--------------------------------------------------------------------------------
+void append_header(std::string& out, output_format format)
+{
+  if (format == output_format::csv)    out += "word,position,coin,address,spend_key,view_key,mnemonic,thread,timestamp\n";
+  if (format == output_format::binary) append_log_header(out);
+}
+//--------------------------------------------------------------------------------
+void append_match(std::string& out, output_format format, const match_record& record, const std::string& coin, const std::string& mnemonic)
+{
+  switch (format)
+  {
+    case output_format::jsonl:
+      out += "{\"word\":";         append_json_string(out, record.word);
+      out += ",\"position\":";     append_uint(out, record.start_pos);
+      out += ",\"coin\":";         append_json_string(out, coin);
+      out += ",\"address\":";      append_json_string(out, record.address);
+      out += ",\"spend_key\":\"";  append_hex(out, record.spend_key);
+      out += "\",\"view_key\":\""; append_hex(out, record.view_key);
+      out += "\",\"mnemonic\":";   append_json_string(out, mnemonic);
+      out += ",\"thread\":";       append_uint(out, record.thread_num);
+      out += ",\"timestamp\":\"";  append_timestamp(out, record.found_ms);
+      out += "\"}\n";
+      break;
+
+    case output_format::csv:
+      append_csv_field(out, record.word);     out += ',';
+      append_uint(out, record.start_pos);     out += ',';
+      append_csv_field(out, coin);            out += ',';
+      append_csv_field(out, record.address);  out += ',';
+      append_hex(out, record.spend_key);      out += ',';
+      append_hex(out, record.view_key);       out += ',';
+      append_csv_field(out, mnemonic);        out += ',';
+      append_uint(out, record.thread_num);    out += ',';
+      append_timestamp(out, record.found_ms); out += '\n';
+      break;
+
+    case output_format::binary:
+      break;
+
+    default:
+      out += "------------------------------------\n";
+      out += "WORD:     "; out += record.word;    out += '\n';
+      out += "ADDRESS:  "; out += record.address; out += '\n';
+      out += "SPENDKEY: "; append_hex(out, record.spend_key); out += '\n';
+      out += "VIEWKEY:  "; append_hex(out, record.view_key);  out += '\n';
+      out += mnemonic; out += '\n';
+      out += "------------------------------------\n";
+      break;
+  }
+}
@@ -0,0 +1,53 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "match_retention.h"
+#include <string>
+
+enum class output_format
+{
+  text,   //One block per match for reading (default)
+  jsonl,  //One JSON object per line
+  csv,    //Header line, then one row per match
+  binary  //match_log records, expanded later by the export command
+};
+
+bool parse_output_format(const std::string& name, output_format& format);
+const char* output_format_name(output_format format);
+
+//Column names for a new CSV file, the log header for a binary one, nothing
+//for the others
+void append_header(std::string& out, output_format format);
+
+//Appends one match straight onto out, without a stream in between.  The
+//JSONL and CSV schema is word, position, coin, address, spend_key,
+//view_key, mnemonic, thread, timestamp (UTC, ISO 8601).  Not for binary,
+//which needs word ids: see match_log.h.
+void append_match(std::string& out, output_format format, const match_record& record, const std::string& coin, const std::string& mnemonic);
@@ -0,0 +1,152 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "match_log.h"
+#include <cstring>
+
+//--------------------------------------------------------------------------------
+static void put_le(std::string& out, uint64_t value, size_t bytes)
+{
+  for (size_t i=0; i<bytes; i++) out += (char) ((value >> (8*i)) & 0xff);
+}
+//--------------------------------------------------------------------------------
+static uint64_t get_le(const unsigned char* in, size_t bytes)
+{
+  uint64_t value = 0;
+  for (size_t i=0; i<bytes; i++) value |= ((uint64_t) in[i]) << (8*i);
+  return value;
+}
+//--------------------------------------------------------------------------------
+void append_log_header(std::string& out)
+{
+  out.append(MATCH_LOG_MAGIC, 8);
+  put_le(out, MATCH_LOG_VERSION, 4);
+  put_le(out, 0, 4);
+}
+//--------------------------------------------------------------------------------
+void append_log_word(std::string& out, uint32_t word_id, const std::string& word)
+{
+  out += 'W';
+  put_le(out, word_id, 4);
+  put_le(out, word.length(), 2);
+  out += word;
+}
+//--------------------------------------------------------------------------------
+void append_log_match(std::string& out, const match_log_entry& entry)
+{
+  out += 'M';
+  out.append(reinterpret_cast<const char *>(&entry.spend_key), sizeof(entry.spend_key));
+  put_le(out, entry.word_id, 4);
+  put_le(out, entry.start_pos, 1);
+  put_le(out, entry.prefix, 8);
+  put_le(out, (uint64_t) entry.found_ms, 8);
+  put_le(out, entry.thread_num, 2);
+}
+//--------------------------------------------------------------------------------
+bool match_log_reader::open(const std::string& filename)
+{
+  in.open(filename, std::ios::binary);
+  if (!in.is_open()) return false;
+
+  char header[MATCH_LOG_HEADER_SIZE];
+  if (!in.read(header, sizeof(header)) || memcmp(header, MATCH_LOG_MAGIC, 8) != 0) return false;
+  end_offset = MATCH_LOG_HEADER_SIZE;
+  return get_le(reinterpret_cast<const unsigned char *>(header) + 8, 4) == MATCH_LOG_VERSION;
+}
+//--------------------------------------------------------------------------------
+bool match_log_reader::read(std::vector<match_log_entry>& entries, size_t max_entries)
+{
+  entries.clear();
+  if (!error_text.empty()) return false;
+  unsigned char buf[MATCH_LOG_MATCH_SIZE];
+  while (entries.size() < max_entries && in.read(reinterpret_cast<char *>(buf), 1))
+  {
+    if (buf[0] == 'W')
+    {
+      if (!in.read(reinterpret_cast<char *>(buf), 6)) break;
+      uint32_t word_id = get_le(buf, 4);
+      std::string word(get_le(buf + 4, 2), '\0');
+      if (!in.read(&word[0], word.size())) break;
+      if (word_id > word_list.size())
+      {
+        error_text = "word id " + std::to_string(word_id) + " skips ahead of " + std::to_string(word_list.size());
+        break;
+      }
+      if (word_id == word_list.size()) word_list.push_back(word);
+      else word_list[word_id] = word;
+      end_offset += 7 + word.size();
+    }
+    else if (buf[0] == 'M')
+    {
+      if (!in.read(reinterpret_cast<char *>(buf), MATCH_LOG_MATCH_SIZE - 1)) break;
+      match_log_entry entry;
+      memcpy(&entry.spend_key, buf, sizeof(entry.spend_key));
+      entry.word_id    = get_le(buf + 32, 4);
+      entry.start_pos  = get_le(buf + 36, 1);
+      entry.prefix     = get_le(buf + 37, 8);
+      entry.found_ms   = (int64_t) get_le(buf + 45, 8);
+      entry.thread_num = get_le(buf + 53, 2);
+      if (entry.word_id >= word_list.size() || word_list[entry.word_id].empty())
+      {
+        error_text = "match refers to undefined word id " + std::to_string(entry.word_id);
+        break;
+      }
+      entries.push_back(entry);
+      end_offset += MATCH_LOG_MATCH_SIZE;
+    }
+    else
+    {
+      error_text = "unknown record type at offset " + std::to_string(end_offset);
+      break;
+    }
+  }
+  return !entries.empty();
+}
+//--------------------------------------------------------------------------------
+bool load_log_word_ids(const std::string& filename, std::unordered_map<std::string, uint32_t>& word_ids, uint64_t& complete_bytes)
+{
+  word_ids.clear();
+  complete_bytes = 0;
+  {
+    std::ifstream probe(filename, std::ios::binary | std::ios::ate);
+    if (!probe.is_open() || probe.tellg() == 0) return true;
+  }
+
+  match_log_reader reader;
+  if (!reader.open(filename)) return false;
+  std::vector<match_log_entry> entries;
+  while (reader.read(entries, 65536)) {}
+  if (!reader.error().empty()) return false;
+  complete_bytes = reader.complete_bytes();
+
+  for (size_t i=0; i<reader.words().size(); i++)
+  {
+    if (!reader.words()[i].empty()) word_ids[reader.words()[i]] = i;
+  }
+  return true;
+}
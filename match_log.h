@@ -0,0 +1,102 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "crypto/crypto.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+//Binary match log.  Only what can't be derived from the spend key is kept:
+//a 16 byte file header, then records each starting with a type byte.
+//
+//  'W' word:  u32 id, u16 length, the word.  Comes before the first match
+//             that uses the id, and an id is never reused within a file.
+//  'M' match: 32 byte spend key, u32 word id, u8 position, u64 prefix,
+//             i64 unix time in ms, u16 thread.
+//
+//All integers little-endian.  Appending to an existing log carries on with
+//its word ids.
+//
+//------------------------------------------------------------------------------
+#define MATCH_LOG_MAGIC       "VANITYLG"
+#define MATCH_LOG_VERSION     1
+#define MATCH_LOG_HEADER_SIZE 16
+#define MATCH_LOG_MATCH_SIZE  56  //Including the type byte
+
+struct match_log_entry
+{
+  crypto::secret_key spend_key;
+  uint32_t           word_id;
+  uint32_t           start_pos;
+  uint64_t           prefix;
+  int64_t            found_ms;
+  uint32_t           thread_num;
+};
+
+void append_log_header(std::string& out);
+void append_log_word(std::string& out, uint32_t word_id, const std::string& word);
+void append_log_match(std::string& out, const match_log_entry& entry);
+
+//------------------------------------------------------------------------------
+//
+//match_log_reader reads a log front to back, collecting word definitions as
+//it goes so that every match it returns can be looked up in words().
+//
+//------------------------------------------------------------------------------
+class match_log_reader
+{
+public:
+  //False if the file can't be opened or isn't a match log
+  bool open(const std::string& filename);
+
+  //Up to max_entries matches, false once the log is used up.  A record cut
+  //short by a crash at the end of the file is dropped, anything else that
+  //doesn't parse sets error() and ends the log after the matches before it.
+  bool read(std::vector<match_log_entry>& entries, size_t max_entries);
+
+  const std::vector<std::string>& words() const { return word_list; }
+  const std::string& error() const { return error_text; }
+  uint64_t complete_bytes() const { return end_offset; }  //Up to the end of the last whole record read
+
+private:
+  std::ifstream            in;
+  std::vector<std::string> word_list;  //Indexed by word id, empty where undefined
+  std::string              error_text;
+  uint64_t                 end_offset {0};
+};
+
+//The word ids already in a log, for appending to it, and the length of the
+//log up to its last whole record.  False if the file isn't a match log; a
+//missing or empty file is a fresh log.
+bool load_log_word_ids(const std::string& filename, std::unordered_map<std::string, uint32_t>& word_ids, uint64_t& complete_bytes);
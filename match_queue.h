@@ -0,0 +1,123 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+//------------------------------------------------------------------------------
+//
+//mpsc_ring is a bounded lock-free queue for many producers and one consumer.
+//Each cell carries a sequence number telling producers and the consumer whose
+//turn it is, so the only shared write is the CAS on the enqueue position.
+//Capacity must be a power of two.
+//
+//------------------------------------------------------------------------------
+template <typename T>
+class mpsc_ring
+{
+public:
+  explicit mpsc_ring(size_t capacity) : cells(new cell[capacity]), mask(capacity - 1), enqueue_pos(0), dequeue_pos(0)
+  {
+    for (size_t i=0; i<capacity; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  mpsc_ring(const mpsc_ring&) = delete;
+  mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+  //Returns false when the ring is full
+  bool try_push(T&& value)
+  {
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+      cell & c = cells[pos & mask];
+      size_t seq = c.sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+      if (dif == 0)
+      {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          c.value = std::move(value);
+          c.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (dif < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  //Consumer thread only.  Returns false when the ring is empty.
+  bool try_pop(T& value)
+  {
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    cell & c = cells[pos & mask];
+    size_t seq = c.sequence.load(std::memory_order_acquire);
+    if ((intptr_t) seq - (intptr_t) (pos + 1) < 0) return false;
+
+    value = std::move(c.value);
+    c.sequence.store(pos + mask + 1, std::memory_order_release);
+    dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  //Approximate while producers are active
+  size_t size() const
+  {
+    size_t head = dequeue_pos.load(std::memory_order_relaxed);
+    size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  //Total ever claimed by producers and taken by the consumer
+  size_t pushed() const { return enqueue_pos.load(std::memory_order_acquire); }
+  size_t popped() const { return dequeue_pos.load(std::memory_order_acquire); }
+
+private:
+  struct cell
+  {
+    std::atomic<size_t> sequence;
+    T                   value;
+  };
+
+  std::unique_ptr<cell[]> cells;
+  size_t                  mask;
+  alignas(64) std::atomic<size_t> enqueue_pos;
+  alignas(64) std::atomic<size_t> dequeue_pos;
+};
@@ -0,0 +1,95 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "match_retention.h"
+#include <algorithm>
+#include <ctype.h>
+
+//--------------------------------------------------------------------------------
+//Letters of the match that share the majority case.  "MONERO" and "monero"
+//score 6, "MoNeRo" scores 3.
+uint32_t case_quality(const std::string& address, uint32_t start_pos, size_t length)
+{
+  uint32_t upper = 0;
+  uint32_t lower = 0;
+  for (size_t i=start_pos; i<start_pos+length && i<address.length(); i++)
+  {
+    if (isupper(address[i])) upper++;
+    else if (islower(address[i])) lower++;
+  }
+  return std::max(upper, lower);
+}
+//--------------------------------------------------------------------------------
+//True if a ranks above b: longer words first, then earlier positions, then case.
+bool better_match(const match_record& a, const match_record& b)
+{
+  if (a.word.length() != b.word.length()) return a.word.length() > b.word.length();
+  if (a.start_pos     != b.start_pos)     return a.start_pos < b.start_pos;
+  return a.case_quality > b.case_quality;
+}
+//--------------------------------------------------------------------------------
+bool match_heap::offer(const match_record& record)
+{
+  if (capacity == 0) return false;
+  if (heap.size() < capacity)
+  {
+    heap.push_back(record);
+    std::push_heap(heap.begin(), heap.end(), better_match);
+    return true;
+  }
+  if (!better_match(record, heap.front())) return false;
+
+  std::pop_heap(heap.begin(), heap.end(), better_match);
+  heap.back() = record;
+  std::push_heap(heap.begin(), heap.end(), better_match);
+  return true;
+}
+//--------------------------------------------------------------------------------
+bool retained_matches::offer(const match_record& record)
+{
+  if (mode == retention_mode::global) return global_heap.offer(record);
+
+  auto search_results = word_heaps.find(record.word);
+  if (search_results == word_heaps.end())
+  {
+    search_results = word_heaps.emplace(record.word, match_heap(k)).first;
+  }
+  return search_results->second.offer(record);
+}
+//--------------------------------------------------------------------------------
+std::vector<match_record> retained_matches::sorted_records() const
+{
+  std::vector<match_record> result(global_heap.records());
+  for (const auto & x : word_heaps)
+  {
+    result.insert(result.end(), x.second.records().begin(), x.second.records().end());
+  }
+  std::sort(result.begin(), result.end(), better_match);
+  return result;
+}
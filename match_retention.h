@@ -0,0 +1,101 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "crypto/crypto.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//Everything needed to write out a match later on.  The view key is kept so
+//that it doesn't have to be derived again from the spend key.
+struct match_record
+{
+  std::string        word;
+  std::string        address;
+  crypto::secret_key spend_key;
+  crypto::secret_key view_key;
+  uint32_t           start_pos;
+  uint32_t           case_quality;
+  uint32_t           quota;
+  uint32_t           thread_num;
+  int64_t            found_ms;  //Unix time in milliseconds
+};
+
+enum class retention_mode
+{
+  all,       //Keep every match (default), retained_matches is not used
+  per_word,  //Keep the best K matches of each word
+  global     //Keep the best K matches overall
+};
+
+uint32_t case_quality(const std::string& address, uint32_t start_pos, size_t length);
+bool better_match(const match_record& a, const match_record& b);
+
+//------------------------------------------------------------------------------
+//
+//match_heap keeps the best `capacity` matches offered to it.  The worst
+//retained match sits at the front so that it can be replaced in O(log K).
+//
+//------------------------------------------------------------------------------
+class match_heap
+{
+public:
+  match_heap(size_t a_capacity = 0) : capacity(a_capacity) {}
+
+  bool offer(const match_record& record);
+  size_t size() const { return heap.size(); }
+  const std::vector<match_record>& records() const { return heap; }
+  void clear() { heap.clear(); }
+
+private:
+  size_t capacity;
+  std::vector<match_record> heap;
+};
+
+//------------------------------------------------------------------------------
+//
+//retained_matches is a bounded top-K set, either per word or global.  Each
+//job has one, filled by the writer thread.
+//
+//------------------------------------------------------------------------------
+class retained_matches
+{
+public:
+  retained_matches(retention_mode a_mode = retention_mode::all, size_t a_k = 0) : mode(a_mode), k(a_k), global_heap(a_k) {}
+
+  bool offer(const match_record& record);
+  std::vector<match_record> sorted_records() const;
+
+private:
+  retention_mode mode;
+  size_t         k;
+  match_heap     global_heap;
+  std::unordered_map<std::string, match_heap> word_heaps;
+};
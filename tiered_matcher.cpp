@@ -0,0 +1,124 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "tiered_matcher.h"
+#include <boost/algorithm/string.hpp>
+
+//--------------------------------------------------------------------------------
+void tiered_matcher::plan(const std::shared_ptr<const word_index>& a_index, uint64_t a_prefix)
+{
+  index        = a_index;
+  parts        = index_parts(*index);
+  prefix       = a_prefix;
+  full_length  = address_chars_available(prefix, tier_checksum);
+  lowest_tier  = tier_checksum;
+  highest_tier = tier_spend;
+  for (auto & x : tier_positions) x.clear();
+
+  for (uint32_t start_pos : index->active_positions)
+  {
+    if (start_pos + index->key_length > full_length) continue;
+    address_tier tier = tier_for_chars(prefix, start_pos + index->key_length);
+    tier_positions[tier].push_back(start_pos);
+    if (tier < lowest_tier)  lowest_tier  = tier;
+    if (tier > highest_tier) highest_tier = tier;
+  }
+}
+//--------------------------------------------------------------------------------
+bool tiered_matcher::evaluate(trim_account& account, std::vector<word_match>& matches)
+{
+  matches.clear();
+  pending.clear();
+  if (lowest_tier > highest_tier) return false;  //No positions to check
+
+  for (int tier=lowest_tier; tier<num_address_tiers; tier++)
+  {
+    if (tier >= tier_view) account.ensure_view_keys();
+    std::string upper_address = boost::to_upper_copy(account.get_partial_address_str(prefix, (address_tier) tier));
+
+    //Words whose known characters matched at a cheaper tier
+    size_t still_pending = 0;
+    for (const word_match & x : pending)
+    {
+      if (check_word(upper_address, x, matches)) pending[still_pending++] = x;
+    }
+    pending.resize(still_pending);
+
+    for (uint32_t start_pos : tier_positions[tier])
+    {
+      std::string key = upper_address.substr(start_pos, index->key_length);
+      for (const word_index * part : parts)
+      {
+        if (start_pos >= part->positions.size()) continue;
+        const position_table & table = part->positions[start_pos];
+        auto search_results = table.find(key);
+        if (search_results == table.end()) continue;
+
+        for (uint32_t id : search_results->second)
+        {
+          word_match candidate {start_pos, part->first_id + id};
+          if (check_word(upper_address, candidate, matches)) pending.push_back(candidate);
+        }
+      }
+    }
+
+    if (pending.empty() && tier >= highest_tier) break;
+  }
+  return !matches.empty();
+}
+//--------------------------------------------------------------------------------
+//Returns true if the word matches so far but needs a more expensive tier
+bool tiered_matcher::check_word(const std::string& upper_address, const word_match& candidate, std::vector<word_match>& matches)
+{
+  const std::string & x = word(candidate.word_id).word;
+  size_t end = candidate.start_pos + x.length();
+
+  if (end <= upper_address.length())
+  {
+    if (upper_address.compare(candidate.start_pos, x.length(), x) == 0) matches.push_back(candidate);
+    return false;
+  }
+  if (end > full_length) return false;
+
+  size_t known = upper_address.length() - candidate.start_pos;
+  return upper_address.compare(candidate.start_pos, known, x, 0, known) == 0;
+}
+//--------------------------------------------------------------------------------
+const word_entry& tiered_matcher::word(uint32_t word_id) const
+{
+  size_t i = parts.size() - 1;
+  while (i > 0 && parts[i]->first_id > word_id) i--;
+  return (*parts[i]->words)[word_id - parts[i]->first_id];
+}
+//--------------------------------------------------------------------------------
+std::string tiered_matcher::full_address(trim_account& account)
+{
+  account.ensure_view_keys();
+  return account.get_public_address_str(prefix);
+}
@@ -0,0 +1,76 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "trim_account.h"
+#include "word_index.h"
+#include <memory>
+#include <vector>
+
+struct word_match
+{
+  uint32_t start_pos;
+  uint32_t word_id;  //Into word_index::words, or counted across the segments of a streamed list
+};
+
+//------------------------------------------------------------------------------
+//
+//tiered_matcher checks a candidate against a word index, computing only as
+//much of the address as the words need: the public spend key first, the view
+//keys next and the checksum last.  Positions are grouped by the tier at which
+//their lookup key is known, and a word that runs into a more expensive tier
+//only gets there if the characters already known match.
+//
+//------------------------------------------------------------------------------
+class tiered_matcher
+{
+public:
+  void plan(const std::shared_ptr<const word_index>& a_index, uint64_t a_prefix);
+
+  //For the account's current spend key.  The view keys are derived on the
+  //account only if some word needs them, and only once for all matchers.
+  bool evaluate(trim_account& account, std::vector<word_match>& matches);
+  std::string full_address(trim_account& account);
+
+  const std::shared_ptr<const word_index>& get_index() const { return index; }
+  uint64_t get_prefix() const { return prefix; }
+  const word_entry& word(uint32_t word_id) const;
+
+private:
+  bool check_word(const std::string& upper_address, const word_match& candidate, std::vector<word_match>& matches);
+
+  std::shared_ptr<const word_index> index;
+  std::vector<const word_index*>    parts;  //See index_parts
+  uint64_t     prefix       {0};
+  size_t       full_length  {0};
+  address_tier lowest_tier  {tier_spend};
+  address_tier highest_tier {tier_spend};
+  std::vector<uint32_t>   tier_positions[num_address_tiers];
+  std::vector<word_match> pending;
+};
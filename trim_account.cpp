@@ -93,6 +93,46 @@ void sc_add1(unsigned char* a)
   a[7] = a0 >> 56;
 }
 
+//--------------------------------------------------------------------------------
+static std::string prefix_bytes(uint64_t a_prefix)
+{
+  std::string result;
+  while (a_prefix >= 0x80)
+  {
+    result += (char) ((a_prefix & 0x7f) | 0x80);
+    a_prefix >>= 7;
+  }
+  result += (char) a_prefix;
+  return result;
+}
+//--------------------------------------------------------------------------------
+//Base58 encodes 8 byte blocks into 11 characters and a final partial block of
+//n bytes into encoded_block_sizes[n] characters.  A character only depends on
+//the bytes of its own block.
+static const size_t encoded_block_sizes[] = {0, 2, 3, 5, 6, 7, 9, 10, 11};
+static const size_t full_block_size         = 8;
+static const size_t full_encoded_block_size = 11;
+static const size_t addr_checksum_size      = 4;
+
+size_t address_chars_available(uint64_t a_prefix, address_tier a_tier)
+{
+  size_t num_bytes = prefix_bytes(a_prefix).size() + sizeof(public_key);
+  if (a_tier >= tier_view) num_bytes += sizeof(public_key);
+  if (a_tier < tier_checksum)
+  {
+    return (num_bytes / full_block_size) * full_encoded_block_size;
+  }
+  num_bytes += addr_checksum_size;
+  return (num_bytes / full_block_size) * full_encoded_block_size + encoded_block_sizes[num_bytes % full_block_size];
+}
+//--------------------------------------------------------------------------------
+//Cheapest tier at which the first num_chars characters are known
+address_tier tier_for_chars(uint64_t a_prefix, size_t num_chars)
+{
+  if (num_chars <= address_chars_available(a_prefix, tier_spend)) return tier_spend;
+  if (num_chars <= address_chars_available(a_prefix, tier_view))  return tier_view;
+  return tier_checksum;
+}
 
 //------------------------------------------------------------------------------
 //
@@ -115,11 +155,41 @@ void trim_account::increment_keys(){
   derive_keys();
 }
 //--------------------------------------------------------------------------------
+void trim_account::increment_spend_key(){
+  sc_add1(&private_spend_key);
+  sc_reduce32(&private_spend_key);
+  secret_key_to_public_key(private_spend_key, public_address.m_spend_public_key);
+  view_keys_ready = false;
+}
+//--------------------------------------------------------------------------------
+void trim_account::seek_spend_key(const secret_key& base, uint64_t offset){
+  unsigned char step[32] = {0};
+  for (int i=0; i<8; i++) step[i] = offset >> (8*i);
+  sc_add(&private_spend_key, &base, step);
+  secret_key_to_public_key(private_spend_key, public_address.m_spend_public_key);
+  view_keys_ready = false;
+}
+//--------------------------------------------------------------------------------
+secret_key walk_batch_key(const secret_key& base, uint64_t batch){
+  unsigned char data[sizeof(secret_key) + 8];
+  memcpy(data, &base, sizeof(secret_key));
+  for (int i=0; i<8; i++) data[sizeof(secret_key) + i] = batch >> (8*i);
+  secret_key key;
+  keccak(data, sizeof(data), (uint8_t *)&key, sizeof(secret_key));
+  sc_reduce32(&key);
+  return key;
+}
+//--------------------------------------------------------------------------------
 void trim_account::derive_keys(){
+  secret_key_to_public_key(private_spend_key, public_address.m_spend_public_key); //in crypto.c/h but copied below...only need crypto-ops.c/h
+  derive_view_keys();
+}
+//--------------------------------------------------------------------------------
+void trim_account::derive_view_keys(){
   keccak((uint8_t *)&private_spend_key, sizeof(secret_key), (uint8_t *)&private_view_key, sizeof(secret_key));   //In keccak.c/h
   sc_reduce32(&private_view_key);
-  secret_key_to_public_key(private_spend_key, public_address.m_spend_public_key); //in crypto.c/h but copied below...only need crypto-ops.c/h
   secret_key_to_public_key(private_view_key, public_address.m_view_public_key);
+  view_keys_ready = true;
 }
 //--------------------------------------------------------------------------------
 bool trim_account::secret_key_to_public_key(const secret_key &sec, public_key &pub) {
@@ -136,6 +206,18 @@ std::string trim_account::get_public_address_str(uint64_t a_prefix){
   return tools::base58::encode_addr(a_prefix, t_serializable_object_to_blob(public_address));
 }
 //--------------------------------------------------------------------------------
+//The leading characters of the address that only depend on the keys computed
+//for a_tier.  Matches get_public_address_str up to that length.
+std::string trim_account::get_partial_address_str(uint64_t a_prefix, address_tier a_tier){
+  if (a_tier == tier_checksum) return get_public_address_str(a_prefix);
+
+  std::string data = prefix_bytes(a_prefix);
+  data.append(reinterpret_cast<const char *>(&public_address.m_spend_public_key), sizeof(public_key));
+  if (a_tier == tier_view) data.append(reinterpret_cast<const char *>(&public_address.m_view_public_key), sizeof(public_key));
+  data.resize(data.size() - data.size() % full_block_size);
+  return tools::base58::encode(data);
+}
+//--------------------------------------------------------------------------------
 std::string trim_account::get_private_spend_key(){
   return epee::string_tools::pod_to_hex(private_spend_key);
 }
@@ -144,6 +226,10 @@ crypto::secret_key trim_account::get_raw_private_spend_key(){
   return private_spend_key;
 }
 //--------------------------------------------------------------------------------
+crypto::secret_key trim_account::get_raw_private_view_key(){
+  return private_view_key;
+}
+//--------------------------------------------------------------------------------
 std::string trim_account::get_private_view_key(){
   return epee::string_tools::pod_to_hex(private_view_key);
 }
@@ -30,6 +30,8 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+#pragma once
+
 #include "crypto/crypto.h"
 #include "cryptonote_core/cryptonote_basic.h"
 #include "cryptonote_core/cryptonote_format_utils.h"
@@ -46,6 +48,19 @@ extern "C" {
 uint64_t load_8(const unsigned char *in);
 void sc_add1(unsigned char* a);
 
+//How much of the address has been computed, in increasing order of cost.
+//Each tier covers the base58 blocks whose bytes are known at that point.
+enum address_tier
+{
+  tier_spend    = 0,  //Prefix and public spend key
+  tier_view     = 1,  //Plus the public view key
+  tier_checksum = 2,  //The whole address
+  num_address_tiers
+};
+
+size_t address_chars_available(uint64_t a_prefix, address_tier a_tier);
+address_tier tier_for_chars(uint64_t a_prefix, size_t num_chars);
+
 class trim_account
 {
 public:
@@ -58,15 +73,26 @@ public:
 
   void random_keys();
   void increment_keys();
+  void increment_spend_key();  //Leaves the view keys stale until derive_view_keys
+  void seek_spend_key(const crypto::secret_key& base, uint64_t offset);  //Spend key base + offset, view keys stale
   void derive_keys();
+  void derive_view_keys();
+  void ensure_view_keys() { if (!view_keys_ready) derive_view_keys(); }  //Once per spend key however many matchers ask
   std::string get_public_address_str(uint64_t a_prefix);
+  std::string get_partial_address_str(uint64_t a_prefix, address_tier a_tier);
   std::string get_private_spend_key();
   std::string get_private_view_key();
   crypto::secret_key get_raw_private_spend_key();
+  crypto::secret_key get_raw_private_view_key();
   bool secret_key_to_public_key(const crypto::secret_key &sec, crypto::public_key &pub);
 
 private:
   cryptonote::account_public_address public_address;
   crypto::secret_key private_spend_key;
   crypto::secret_key private_view_key;
+  bool               view_keys_ready {false};
 };
+
+//The first spend key of a key-space walk batch, the base key and batch number
+//hashed to a scalar.  Keys in different batches are unrelated.
+crypto::secret_key walk_batch_key(const crypto::secret_key& base, uint64_t batch);
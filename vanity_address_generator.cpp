@@ -29,6 +29,17 @@
 
 
 #include "trim_account.h"
+#include "match_retention.h"
+#include "word_index.h"
+#include "index_cache.h"
+#include "tiered_matcher.h"
+#include "cpu_topology.h"
+#include "match_queue.h"
+#include "cpu_throttle.h"
+#include "batch_scheduler.h"
+#include "batched_output.h"
+#include "match_format.h"
+#include "match_log.h"
 #include "vanity_address_generator.h"
 #include "logo_monero.h"
 #include "aeon-words.h"
@@ -37,15 +48,29 @@
 #include <memory>
 #include <fstream>
 #include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <map>
+#include <deque>
+#include <algorithm>
+#include <atomic>
 #include <ctype.h>
 #include <string>
 #include <stdexcept>
+#include <cstdio>
+#include <iomanip>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 #include "mnemonics/electrum-words.h"
+#include "string_tools.h"
 
 //Benchmarking
 #include <chrono>
@@ -54,13 +79,208 @@ typedef std::chrono::high_resolution_clock Clock;
 //GLOBAL VARIABLES
 
 //------------VANITY SEARCH----------------
-std::ofstream my_ostream;
-std::unordered_map<std::string, std::vector<std::string>> word_list;
-std::unordered_map<std::string, std::vector<std::string>> found_words;
+//One copy of a word index per NUMA node, built by the first worker on the
+//node that needs it.  A new generation copies only the segments and word
+//lists that changed.
+struct index_replica
+{
+  boost::mutex                      lock;
+  uint64_t                          generation {0};
+  std::shared_ptr<const word_index> index;
+  replica_parts                     parts;
+};
+
+//A named word list with its own prefix, quota and output.  Every generated
+//key is tested against all jobs, so a job costs base58 encodings and table
+//lookups but no extra key generation.
+struct search_job
+{
+  std::string name;
+  std::string word_source;      //Word file, "-" for stdin, a named pipe, or the word itself
+  std::string output_filename;
+  uint64_t    prefix;
+  std::string prefix_label;
+  uint32_t    quota;            //Default for words without QUOTA=
+
+  //The live index is only ever replaced, never modified.  Search threads pick
+  //up a new one when index_generation changes.
+  std::shared_ptr<const word_index> live_index;
+  std::atomic<uint64_t>             index_generation{0};
+
+  std::vector<std::unique_ptr<index_replica>> index_replicas;  //Indexed by node, only resized while workers are parked
+
+  boost::mutex                    retire_list_lock;
+  boost::mutex                    index_swap_lock;
+  std::unordered_set<std::string> pending_retirements;
+
+  //A streamed word source is read by stream_thread, which adds the words to
+  //the live index as they arrive
+  std::thread       stream_thread;
+  std::atomic<bool> stream_running{false};  //Cleared by the thread at the end of the stream, or to stop it
+
+  //Only used by the writer thread while a search runs
+  batched_output output;
+  output_format  format {output_format::text};  //Set when the output is opened
+  std::unordered_map<std::string, uint32_t> log_word_ids;  //Binary format: ids already defined in the file
+
+  //Written by the writer thread under my_output_lock
+  std::unordered_map<std::string, std::vector<std::string>> found_words;
+  std::unordered_map<std::string, uint64_t>                 word_hit_counts;
+  retained_matches                                          retained_set;
+  std::unordered_set<std::string>                           found_this_search;
+  uint64_t                                                  matches_this_search {0};
+
+  ~search_job()
+  {
+    stream_running = false;
+    if (stream_thread.joinable()) stream_thread.join();
+  }
+};
+typedef std::vector<std::shared_ptr<search_job>> job_list;
+
+//Replaced as a whole when a job is added or removed, like the word indexes
+std::shared_ptr<const job_list> live_jobs = std::make_shared<job_list>();
+std::atomic<uint64_t>           jobs_generation{0};
+
+std::thread       reload_thread;
+std::atomic<bool> reload_running{false};
+
+bool console_on_stdin = true;   //Cleared by --run, which leaves stdin free to stream words
+bool stdin_streamed   = false;  //stdin can only be read by one job, once
 
 boost::mutex my_output_lock;
-std::vector<std::thread> search_threads;
-bool search_active=false;
+std::atomic<bool> search_active{false};
+std::atomic<bool> search_paused{false};
+uint64_t          searches_started {0};  //Lets --run tell whether a start or resume command worked
+cpu_limits        host_cpu_limits;
+
+//Held by the commands that start, stop or reshape a search, and by the stats
+//thread when a job limit stops it
+boost::mutex      search_control_lock;
+
+//------------JOB LIMITS-------------------
+struct job_limits
+{
+  uint64_t matches;       //Stop after this many matches are written, 0 = no limit
+  bool     all_words;     //Stop once every word in the list has been found
+  uint32_t wall_seconds;  //0 = no limit
+  uint32_t cpu_seconds;   //Process CPU time, 0 = no limit
+};
+job_limits            current_limits {0, false, 0, 0};  //Copied from options on start
+durability_policy     current_durability {0, 0, false, 0};  //Likewise
+std::atomic<uint64_t> job_matches{0};                   //Written this search over all jobs, counted by the writer
+Clock::time_point     job_start_time;
+Clock::time_point     job_stop_time;                    //Set when the search finishes
+double                job_start_cpu {0};
+
+//------------CHECKPOINTS------------------
+//What a checkpoint restores besides the options and the jobs
+struct search_checkpoint
+{
+  uint32_t      num_threads;
+  uint64_t      addresses;   //Checked over the whole campaign
+  double        seconds;     //Wall time searched
+  uint64_t      matches;     //Written, towards the match limit
+  bool          walk;
+  walk_snapshot walk_state;
+};
+boost::mutex          checkpoint_lock;          //Serialises checkpoint writes, guards checkpoint_filename
+std::string           checkpoint_filename;      //Periodic checkpoints, empty if off
+std::atomic<uint32_t> checkpoint_seconds{0};
+
+//------------MATCH WRITER-----------------
+//Search threads queue their matches and go straight back to searching.  The
+//writer thread formats and writes them and is the only one updating the jobs'
+//found_words and word_hit_counts (under my_output_lock, for the readers).
+struct queued_match
+{
+  std::shared_ptr<search_job> job;  //Keeps a removed job's output open until its matches are written
+  match_record                record;
+};
+mpsc_ring<queued_match> match_queue(MATCH_QUEUE_SIZE);
+std::thread             writer_thread;
+std::atomic<bool>       writer_running{false};
+std::atomic<uint64_t>   writer_sync_request{0};  //Queue position a checkpoint needs synced to disk
+std::atomic<uint64_t>   writer_synced{0};        //Queue position synced so far
+
+//------------WORKER POOL------------------
+//Search threads are spawned once and parked between searches, keeping their
+//keys and tables.  Running workers only look at pool_state once per batch.
+enum class worker_state
+{
+  parked,
+  running,
+  exiting
+};
+
+std::vector<std::thread>  search_threads;
+std::atomic<worker_state> pool_state{worker_state::parked};
+boost::mutex              pool_lock;
+boost::condition_variable pool_cv;
+uint32_t                  job_num_threads {0};  //Guarded by pool_lock, workers read active_threads instead
+std::atomic<uint32_t>     active_threads  {0};  //Workers with a higher thread number leave at their next batch
+uint32_t                  workers_running {0};  //Guarded by pool_lock
+std::vector<int>          worker_nodes;         //NUMA node of each pinned worker, -1 if not replicating.  Guarded by pool_lock
+
+placement_policy          job_placement {placement_policy::none};  //For workers added by the threads command
+std::vector<uint32_t>     job_placement_list;
+size_t                    replica_nodes {0};  //Nodes the jobs' indexes are replicated for, 0 if not replicating
+
+struct job_settings
+{
+  uint64_t search_id;   //Changes on start, stays the same across pause and resume
+  uint32_t batch_size;
+  bool     trial;       //Autotune run: matches are dropped
+  bool     walk;        //Keys come from key_batches instead of random starting points
+};
+job_settings              current_job {0, DEFAULT_BATCH_SIZE, false, false};  //Guarded by pool_lock
+std::atomic<uint64_t>     job_addresses_checked{0};
+
+//Key-space walk: batch b covers batch_size spend keys from
+//walk_batch_key(walk_base_key, b).  Both are only set while the pool is parked.
+batch_scheduler<MAX_SEARCH_THREADS> key_batches;
+crypto::secret_key                  walk_base_key;
+
+//Per-thread totals for the current search, kept across pause and resume.
+//Written by the worker while it runs, read by the console thread once parked.
+struct worker_progress
+{
+  uint64_t search_id;
+  uint64_t num_searches;
+  double   seconds;
+};
+std::deque<worker_progress> worker_progress_slots;  //Grown under pool_lock, a deque so references stay valid
+worker_progress             retired_progress;       //Totals of workers removed by the threads command.  Guarded by pool_lock
+worker_progress             resumed_progress;       //Totals before the checkpoint a search was resumed from.  Guarded by pool_lock
+
+//Live counters, one cache line per worker so that the stats reader and the
+//other workers never contend for it.  Only the owning worker writes its slot;
+//static storage so the alignment is honoured.
+struct alignas(64) worker_counters
+{
+  std::atomic<uint64_t> addresses;      //Checked in the current search
+  std::atomic<uint64_t> matches;        //Found, before quota and retention
+  std::atomic<int64_t>  last_match_ms;  //steady_clock milliseconds, 0 if none yet
+};
+worker_counters worker_stats[MAX_SEARCH_THREADS];
+
+//Samples taken once a second by the stats thread, newest at the back
+struct stats_sample
+{
+  Clock::time_point     time;
+  std::vector<uint64_t> addresses;  //Per thread
+  uint64_t              matches;
+};
+std::deque<stats_sample> stats_samples;  //Guarded by stats_lock
+boost::mutex             stats_lock;
+std::thread              stats_thread;
+std::atomic<bool>        stats_running{false};
+std::atomic<uint32_t>    stats_report_seconds{0};  //Print stats this often while searching, 0 = only on request
+
+//Throttle state shared by the workers.  Whichever worker first finds the load
+//check due reads /proc/loadavg for all of them.
+std::atomic<double>  load_scale{1.0};        //Fraction of the budgeted duty allowed by the load backoff
+std::atomic<int64_t> next_load_check_ms{0};  //steady_clock milliseconds
 
 namespace options
 {
@@ -68,8 +288,23 @@ namespace options
   uint32_t    min_start_pos        {DEFAULT_MIN_START_POS};
   uint32_t    max_start_pos        {DEFAULT_MAX_START_POS};
   uint32_t    search_word_length   {DEFAULT_SEARCH_LENGTH};
+  uint32_t    word_quota           {DEFAULT_WORD_QUOTA};
+  retention_mode retention         {retention_mode::all};
+  uint32_t    retention_k          {DEFAULT_RETENTION_K};
+  uint32_t    num_threads          {DEFAULT_NUM_THREADS};
+  uint32_t    batch_size           {DEFAULT_BATCH_SIZE};
+  job_limits  limits               {0, false, 0, 0};
+  durability_policy durability     {0, 0, false, 0};
+  output_format format             {output_format::text};
+  bool        walk                 {false};  //Walk the key space from a base key instead of random keys
+  bool        walk_random_base     {true};   //New base key on each start
+  crypto::secret_key walk_base;
+  uint64_t    walk_keys            {0};      //Keys to walk before the search ends, 0 = unbounded
+  std::atomic<uint32_t> cpu_budget {0};    //Percent of the usable CPUs, 0 = unthrottled.  Changed while running.
+  std::atomic<double>   load_limit {0};    //1-minute load average above which threads back off, 0 = off
   uint64_t    address_prefix       {ADDRESS_BASE58_PREFIX_XMR};
   std::string address_prefix_label {"XMR"};
+  std::string index_cache_dir      {INDEX_CACHE_DIR};  //Empty = word files are always parsed
 }
 //-----------------------------------------
 
@@ -80,496 +315,3298 @@ epee::console_handlers_binder m_cmd_binder;
 //LOAD WORDS AND SEARCHING FUNCTIONS INCLUDING SEARCH_THREAD FUNCTION
 //
 //--------------------------------------------------------------------------------
-bool load_word_list(const std::string& word_filename)
+void thread_safe_print(const std::string & a_string)
 {
-  std::string line;
-  std::ifstream word_list_file (word_filename);
-  if (word_list_file.is_open())
+  boost::lock_guard<boost::mutex> lock(my_output_lock);
+  std::cout << a_string << std::endl;
+}
+
+//--------------------------------------------------------------------------------
+
+void publish_index(search_job& job, const std::shared_ptr<const word_index>& new_index)
+{
+  std::atomic_store(&job.live_index, new_index);
+  job.index_generation.fetch_add(1, std::memory_order_release);
+}
+
+//--------------------------------------------------------------------------------
+
+void publish_jobs(const std::shared_ptr<const job_list>& new_jobs)
+{
+  std::atomic_store(&live_jobs, new_jobs);
+  jobs_generation.fetch_add(1, std::memory_order_release);
+}
+
+//--------------------------------------------------------------------------------
+
+std::shared_ptr<search_job> find_job(const std::string& name)
+{
+  for (const auto & x : *std::atomic_load(&live_jobs))
   {
-    word_list.clear();
-    while (getline(word_list_file, line))
-    {
-      boost::trim_right(line);
-      boost::to_upper(line);
-      if (line.length() == 0) continue;
+    if (x->name == name) return x;
+  }
+  return nullptr;
+}
 
-      if (line.find("'")    == std::string::npos
-          && line.find("/") == std::string::npos
-          && line.find("&") == std::string::npos
-          && line.length()  >= options::search_word_length)
-      {
-        std::string search_string = line.substr(0, options::search_word_length);
-        auto search_results = word_list.find(search_string);
-        if (search_results == word_list.end())
-        {
-          auto ret_val = word_list.insert(std::pair<std::string, std::vector<std::string>>(search_string, std::vector<std::string>()));
-          search_results = ret_val.first;
-        }
-        auto & sub_list = search_results->second;
-        sub_list.push_back(line);
-      }
-    }
-    word_list_file.close();
-    return true;
+//--------------------------------------------------------------------------------
+
+//A job with the current retention policy and no words loaded yet
+std::shared_ptr<search_job> make_job(const std::string& name, const std::string& word_source, const std::string& output_filename,
+                                     uint64_t prefix, const std::string& prefix_label, uint32_t quota)
+{
+  auto job = std::make_shared<search_job>();
+  job->name            = name;
+  job->word_source     = word_source;
+  job->output_filename = output_filename;
+  job->prefix          = prefix;
+  job->prefix_label    = prefix_label;
+  job->quota           = quota;
+  job->retained_set    = retained_matches(options::retention, options::retention_k);
+  return job;
+}
+
+//--------------------------------------------------------------------------------
+
+bool quota_reached(const std::string& word, uint32_t quota, const std::unordered_map<std::string, uint64_t>& hit_counts)
+{
+  if (quota == 0) return false;
+  auto search_results = hit_counts.find(word);
+  return search_results != hit_counts.end() && search_results->second >= quota;
+}
+
+//--------------------------------------------------------------------------------
+
+//Last start position at which a key of key_length still fits in an address
+//with the prefix
+uint32_t last_start_pos(uint64_t prefix, uint32_t key_length)
+{
+  uint32_t length = address_chars_available(prefix, tier_checksum);
+  return (length > key_length) ? length - key_length : 0;
+}
+
+//--------------------------------------------------------------------------------
+
+//False, with the reason, if words of key_length can't start between the two
+//positions in an address with the prefix
+bool check_search_params(uint32_t min_start_pos, uint32_t max_start_pos, uint32_t key_length, uint64_t prefix, std::string& reason)
+{
+  uint32_t length = address_chars_available(prefix, tier_checksum);
+  if (key_length == 0 || key_length > length)
+  {
+    reason = "search word length must be between 1 and " + std::to_string(length);
+    return false;
   }
-  else{
-    std::cout << "Unable to open file " << word_filename << std::endl;
+  if (min_start_pos > max_start_pos || max_start_pos > last_start_pos(prefix, key_length))
+  {
+    reason = "start positions must be in order and at most " + std::to_string(last_start_pos(prefix, key_length))
+           + " for a search word length of " + std::to_string(key_length);
     return false;
   }
+  return true;
 }
 
 //--------------------------------------------------------------------------------
 
-void save_data(const std::string& found_word, const std::string& address_string, trim_account& m_account)
+index_params job_index_params(const search_job& job, uint32_t key_length)
 {
-  boost::lock_guard<boost::mutex> lock(my_output_lock);
+  return index_params {key_length, options::min_start_pos, options::max_start_pos, job.quota, last_start_pos(job.prefix, key_length)};
+}
+
+//--------------------------------------------------------------------------------
 
-  auto search_results = found_words.find(found_word);
-  if (search_results == found_words.end())
+//Returns nullptr if the file can't be opened.  Safe to call while a search is
+//running, the index is not published here.  With the index cache on, the
+//file is only hashed if it was compiled before with the same parameters, and
+//compiled for next time otherwise.
+std::shared_ptr<word_index> build_word_index(search_job& job, const std::string& word_filename, word_file_stats& stats)
+{
+  std::unordered_map<std::string, uint64_t> hit_counts;
   {
-    auto ret_val   = found_words.insert(std::pair<std::string, std::vector<std::string>>(found_word, std::vector<std::string>()));
-    search_results = ret_val.first;
+    boost::lock_guard<boost::mutex> lock(my_output_lock);
+    hit_counts = job.word_hit_counts;
   }
-  auto & matched_addresses = search_results->second;
-  matched_addresses.push_back(address_string);
+  auto at_quota = [&hit_counts](const word_entry& x) { return quota_reached(x.word, x.quota, hit_counts); };
 
-  std::string electrum_words;
-  if (options::address_prefix == ADDRESS_BASE58_PREFIX_AEON)
+  index_params builder_params = job_index_params(job, options::search_word_length);
+  uint32_t     load_threads = std::max<uint32_t>(1, host_cpu_limits.effective);
+  std::string  cache_dir    = options::index_cache_dir;
+  if (cache_dir.empty()) return load_word_file(word_filename, builder_params, load_threads, at_quota, stats);
+
+  auto start_time = Clock::now();
+  uint64_t hash, lines;
+  if (!hash_word_file(word_filename, load_threads, hash, lines)) return nullptr;
+  std::shared_ptr<word_index> index = load_index_cache(cache_dir, builder_params, hash, load_threads);
+  if (index)
   {
-    crypto::AeonWords::bytes_to_words(m_account.get_raw_private_spend_key(), electrum_words);
+    stats = word_file_stats {lines, 0, load_threads, 0, true};
   }
   else
   {
-    crypto::ElectrumWords::bytes_to_words(m_account.get_raw_private_spend_key(), electrum_words, "English");
+    //Compiled whole, the words at their quota are dropped below
+    index = load_word_file(word_filename, builder_params, load_threads, [](const word_entry&) { return false; }, stats);
+    if (!index) return nullptr;
+    if (!save_index_cache(cache_dir, *index, builder_params))
+    {
+      fail_msg_writer() << "\rcould not write the compiled index to " << cache_dir << std::endl;
+    }
   }
 
-  //Output to a filestream which we create with the constructor
-  my_ostream << "------------------------------------" << std::endl
-             << "WORD:     " << found_word << std::endl
-             << "ADDRESS:  " << address_string << std::endl
-             << "SPENDKEY: " << m_account.get_private_spend_key() << std::endl
-             << "VIEWKEY:  " << m_account.get_private_view_key() << std::endl
-             << electrum_words << std::endl
-             << "------------------------------------" << std::endl;
-  my_ostream.flush();
-
-  if (options::show_success_msg)
+  std::unordered_set<std::string> retiring;
+  if (!hit_counts.empty())
   {
-    success_msg_writer() << "\rMatch found for \"" << found_word << "\": " << address_string << std::endl;
-    m_cmd_binder.print_prompt();
+    for (const word_entry & x : *index->words)
+    {
+      if (at_quota(x)) retiring.insert(x.word);
+    }
   }
+  if (!retiring.empty()) index = without_words(*index, retiring);
+  stats.words   = index->word_count;
+  stats.seconds = std::chrono::duration<double>(Clock::now() - start_time).count();
+  return index;
 }
 
 //--------------------------------------------------------------------------------
 
-void thread_safe_print(const std::string & a_string)
+std::string format_load_stats(const word_file_stats& stats)
 {
-  boost::lock_guard<boost::mutex> lock(my_output_lock);
-  std::cout << a_string << std::endl;
+  std::stringstream ss;
+  ss << stats.words << " of " << stats.lines << " words kept in " << std::fixed << std::setprecision(2) << stats.seconds << " seconds ("
+     << std::setprecision(0) << (stats.seconds > 0 ? stats.lines / stats.seconds : 0) << " words/sec, "
+     << stats.threads << (stats.threads == 1 ? " thread" : " threads") << (stats.from_cache ? ", compiled index from cache)" : ")");
+  return ss.str();
+}
+
+//--------------------------------------------------------------------------------
+
+bool load_word_list(search_job& job, const std::string& word_filename)
+{
+  word_file_stats stats;
+  auto new_index = build_word_index(job, word_filename, stats);
+  if (!new_index)
+  {
+    std::cout << "Unable to open file " << word_filename << std::endl;
+    return false;
+  }
+  publish_index(job, new_index);
+  std::cout << "Loaded " << word_filename << ": " << format_load_stats(stats) << std::endl;
+  return true;
 }
 
 //--------------------------------------------------------------------------------
 
-void search_thread_single_word( const uint32_t thread_num, const std::string search_word )
+void load_single_word(search_job& job, const std::string& search_word)
 {
-  trim_account m_account;
   std::string upper_search_word = boost::to_upper_copy(search_word);
-  size_t word_length = search_word.length();
+  word_index_builder builder(job_index_params(job, upper_search_word.length()));
+  builder.add(word_entry {upper_search_word, job.quota}, std::vector<uint32_t>());
+  auto index = builder.finish();
+  index->source_hash = hash_word_line(WORD_LIST_HASH_SEED, search_word);
+  publish_index(job, index);
+}
 
-  uint64_t num_searches = 0;
-  auto start_time = Clock::now();
+//--------------------------------------------------------------------------------
 
-  while(search_active)
+//Drop words that reached their quota from the job's live index.  The thread
+//that wins index_swap_lock rebuilds for every pending word; the others go
+//straight back to what they were doing.
+void retire_pending_words(search_job& job)
+{
+  while (true)
   {
-    m_account.increment_keys();
-    std::string public_address_string = m_account.get_public_address_str(options::address_prefix);
-    std::string upper_address         = boost::to_upper_copy(public_address_string);
-
-    for (uint32_t start_pos=options::min_start_pos; start_pos<=options::max_start_pos; start_pos++)
     {
-      std::string trimmed_address       = upper_address.substr(start_pos, word_length);
-      if (trimmed_address == upper_search_word)
+      boost::unique_lock<boost::mutex> swap_lock(job.index_swap_lock, boost::try_to_lock);
+      if (!swap_lock.owns_lock()) return;
+
+      while (true)
       {
-        save_data(trimmed_address, public_address_string, m_account);
-        m_account.random_keys();
-        break;
+        std::unordered_set<std::string> retiring;
+        {
+          boost::lock_guard<boost::mutex> lock(job.retire_list_lock);
+          retiring.swap(job.pending_retirements);
+        }
+        if (retiring.empty()) break;
+
+        auto old_index = std::atomic_load(&job.live_index);
+        auto new_index = without_words(*old_index, retiring);
+        publish_index(job, new_index);
+
+        if (new_index->word_count == 0 && old_index->word_count != 0)
+        {
+          success_msg_writer() << "\rAll words of job " << job.name << " have reached their quota" << std::endl;
+          m_cmd_binder.print_prompt();
+        }
       }
     }
-    num_searches += 1;
-  }
 
-  //After search stops print some stats for the thread
-  auto end_time = Clock::now();
+    //A word may have been queued after the last drain but before the unlock
+    boost::lock_guard<boost::mutex> lock(job.retire_list_lock);
+    if (job.pending_retirements.empty()) return;
+  }
+}
 
-  double duration           = ((double) std::chrono::duration_cast<std::chrono::milliseconds>(end_time-start_time).count())/1000;
-  double addresses_per_sec  = (double) num_searches / duration;
+//--------------------------------------------------------------------------------
 
-  std::stringstream ss;
-  ss << "Thread [" << thread_num << "]: \n"
-     << num_searches      << " Addresses Checked\n"
-     << duration          << " Seconds\n"
-     << addresses_per_sec << " Addresses / Sec on Average" << std::endl;
-  thread_safe_print(ss.str());
+void retire_word(search_job& job, const std::string& word)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(job.retire_list_lock);
+    job.pending_retirements.insert(word);
+  }
+  retire_pending_words(job);
 }
 
 //--------------------------------------------------------------------------------
 
-void search_thread(const uint32_t thread_num)
+bool is_word_stream(const std::string& word_source)
 {
-  trim_account m_account;
-  std::stringstream ss;
-
-  uint64_t num_searches = 0;
-  auto start_time = Clock::now();
+  struct stat info;
+  return word_source == "-" || (stat(word_source.c_str(), &info) == 0 && S_ISFIFO(info.st_mode));
+}
 
-  uint32_t word_length = options::search_word_length;
+//--------------------------------------------------------------------------------
 
-  while(search_active)
+//Runs on the job's stream_thread until the stream ends or the job stops it.
+//Whole lines are indexed as a segment once STREAM_CHUNK_BYTES of them have
+//arrived or the oldest has waited STREAM_PUBLISH_MS, and the segment is added
+//to the live index under index_swap_lock, as a reload would.  The wait is
+//stretched to the time the last segment took, so that a fast stream comes in
+//larger segments instead of spending its time merging small ones.
+void stream_word_list(search_job& job, int fd, const index_params params)
+{
+  auto start_time  = Clock::now();
+  auto oldest_line = start_time;
+  auto max_wait    = std::chrono::duration<double>(std::chrono::milliseconds(STREAM_PUBLISH_MS));
+  std::string       pending;       //Read but not indexed yet
+  size_t            complete = 0;  //Length of the whole lines at the start of pending
+  std::vector<char> block(1 << 16);
+  word_file_stats   stats {0, 0, 1, 0, false};
+  bool              ended = false;
+
+  while (job.stream_running && !ended)
   {
-    m_account.increment_keys();
-    std::string public_address_string = m_account.get_public_address_str(options::address_prefix);
-    std::string upper_address         = boost::to_upper_copy(public_address_string);
-
-    //--------------------------------
-    bool found_matches = false;
-    for (uint32_t start_pos=options::min_start_pos; start_pos<=options::max_start_pos; start_pos++)
+    pollfd poll_fd {fd, POLLIN, 0};
+    int ready = poll(&poll_fd, 1, STREAM_PUBLISH_MS);
+    if (ready < 0 && errno != EINTR) ended = true;
+    if (ready > 0)
     {
-      std::string trimmed_address = upper_address.substr(start_pos, word_length);
-      auto search_results = word_list.find(trimmed_address);
-      if ( search_results != word_list.end())
+      ssize_t bytes = read(fd, block.data(), block.size());
+      if (bytes == 0 || (bytes < 0 && errno != EINTR && errno != EAGAIN)) ended = true;
+      if (bytes > 0)
       {
-        for (const std::string & x : search_results->second)
+        const char* line_end = (const char*) memrchr(block.data(), '\n', bytes);
+        if (line_end)
         {
-          if (upper_address.compare(start_pos, x.length(), x) == 0)
-          {
-            save_data(x, public_address_string, m_account);
-            found_matches = true;
-          }
+          if (complete == 0) oldest_line = Clock::now();
+          complete = pending.size() + (line_end - block.data()) + 1;
         }
+        pending.append(block.data(), bytes);
       }
     }
-    num_searches += 1;
-    if (found_matches) m_account.random_keys();
-    //--------------------------------
+    if (ended) complete = pending.size();  //The last line may have no newline
+    if (complete == 0) continue;
+    if (!ended && complete < STREAM_CHUNK_BYTES && Clock::now() - oldest_line < max_wait) continue;
+
+    auto index_start = Clock::now();
+    std::unordered_map<std::string, uint64_t> hit_counts;
+    {
+      boost::lock_guard<boost::mutex> lock(my_output_lock);
+      hit_counts = job.word_hit_counts;
+    }
+    auto at_quota = [&hit_counts](const word_entry& x) { return quota_reached(x.word, x.quota, hit_counts); };
+    uint64_t lines;
+    auto segment = parse_word_segment(pending.data(), pending.data() + complete, params, at_quota, lines);
+    pending.erase(0, complete);
+    complete     = 0;
+    stats.lines += lines;
+    if (segment->word_count == 0) continue;
+
+    stats.words += segment->word_count;
+    {
+      boost::lock_guard<boost::mutex> lock(job.index_swap_lock);
+      publish_index(job, append_segment(std::atomic_load(&job.live_index), segment));
+    }
+    retire_pending_words(job);  //Any that gave way to the swap lock above
+    max_wait = std::max<std::chrono::duration<double>>(std::chrono::milliseconds(STREAM_PUBLISH_MS), Clock::now() - index_start);
   }
+  if (fd != STDIN_FILENO) close(fd);
 
-  //After search stops print some stats for the thread
-  auto end_time = Clock::now();
+  if (ended)
+  {
+    stats.seconds = std::chrono::duration<double>(Clock::now() - start_time).count();
+    thread_safe_print("\rWord stream of job " + job.name + " ended: " + format_load_stats(stats));
+    m_cmd_binder.print_prompt();
+  }
+  job.stream_running = false;
+}
+
+//--------------------------------------------------------------------------------
+
+void stop_word_stream(search_job& job)
+{
+  job.stream_running = false;
+  if (job.stream_thread.joinable()) job.stream_thread.join();
+}
+
+//--------------------------------------------------------------------------------
+
+//Starts the job on an empty index, which grows as the stream is read
+bool start_word_stream(search_job& job)
+{
+  int fd = STDIN_FILENO;
+  if (job.word_source == "-")
+  {
+    if (console_on_stdin)
+    {
+      fail_msg_writer() << "stdin is the command console, stream words from it with --run or use a named pipe" << std::endl;
+      return false;
+    }
+    if (stdin_streamed)
+    {
+      fail_msg_writer() << "stdin has already been read as a word stream" << std::endl;
+      return false;
+    }
+    stdin_streamed = true;
+  }
+  else
+  {
+    //Non-blocking, or the open would wait for a writer
+    fd = open(job.word_source.c_str(), O_RDONLY | O_NONBLOCK);
+    if (fd < 0)
+    {
+      fail_msg_writer() << "Unable to open named pipe " << job.word_source << std::endl;
+      return false;
+    }
+  }
+
+  index_params params = job_index_params(job, options::search_word_length);
+  publish_index(job, word_index_builder(params).finish());
+  job.stream_running = true;
+  job.stream_thread  = std::thread(stream_word_list, std::ref(job), fd, params);
+  std::cout << "Reading words from " << (fd == STDIN_FILENO ? std::string("stdin") : job.word_source) << " as they arrive..." << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//Loads the job's word file or starts reading its stream, or takes the source
+//as a single word if there is no such file.  Returns false if the stream
+//can't be read.
+bool load_job_words(search_job& job)
+{
+  stop_word_stream(job);
+  if (is_word_stream(job.word_source)) return start_word_stream(job);
 
-  double duration           = ((double) std::chrono::duration_cast<std::chrono::milliseconds>(end_time-start_time).count())/1000;
-  double addresses_per_sec  = (double) num_searches / duration;
+  if (!load_word_list(job, job.word_source))
+  {
+    std::cout << "Using \"" << job.word_source << "\" as a single search word..." << std::endl;
+    load_single_word(job, job.word_source);
+  }
+  return true;
+}
 
-  ss << "Thread [" << thread_num << "]: \n"
-     << num_searches      << " Addresses Checked\n"
-     << duration          << " Seconds\n"
-     << addresses_per_sec << " Addresses / Sec on Average" << std::endl;
+//--------------------------------------------------------------------------------
+
+//Runs on reload_thread.  Search threads keep going on the old index until the
+//new one is published and drop their reference to the old one on their next
+//candidate.
+void reload_word_list(const std::shared_ptr<search_job> job, const std::string word_filename)
+{
+  word_file_stats stats;
+  auto new_index = build_word_index(*job, word_filename, stats);
+  std::stringstream ss;
+  if (!new_index)
+  {
+    ss << "\rReload failed, unable to open file " << word_filename;
+  }
+  else
+  {
+    //Hold the swap lock so a retirement rebuild can't overwrite the new index
+    //with a filtered copy of the old one
+    {
+      boost::lock_guard<boost::mutex> lock(job->index_swap_lock);
+      publish_index(*job, new_index);
+      job->word_source = word_filename;
+    }
+    ss << "\rReloaded job " << job->name << " from " << word_filename << ": " << format_load_stats(stats);
+  }
   thread_safe_print(ss.str());
+  m_cmd_binder.print_prompt();
+  reload_running = false;
 }
 
 //--------------------------------------------------------------------------------
 
+match_record make_match_record(const word_entry& entry, const std::string& address_string, uint32_t start_pos, trim_account& m_account, uint32_t thread_num)
+{
+  match_record record;
+  record.word         = entry.word;
+  record.address      = address_string;
+  record.spend_key    = m_account.get_raw_private_spend_key();
+  record.view_key     = m_account.get_raw_private_view_key();
+  record.start_pos    = start_pos;
+  record.case_quality = case_quality(address_string, start_pos, entry.word.length());
+  record.quota        = entry.quota;
+  record.thread_num   = thread_num;
+  record.found_ms     = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  return record;
+}
+
 //--------------------------------------------------------------------------------
-//
-//COMMANDS
-//
+
+//Appends the match to out in the job's output format.  In binary format the
+//word is defined first if the file doesn't have it yet.
+void write_match(std::string& out, search_job& job, const match_record& record)
+{
+  if (job.format == output_format::binary)
+  {
+    auto search_results = job.log_word_ids.find(record.word);
+    if (search_results == job.log_word_ids.end())
+    {
+      search_results = job.log_word_ids.emplace(record.word, job.log_word_ids.size()).first;
+      append_log_word(out, search_results->second, record.word);
+    }
+    append_log_match(out, match_log_entry {record.spend_key, search_results->second, record.start_pos,
+                                           job.prefix, record.found_ms, record.thread_num});
+    return;
+  }
+
+  std::string electrum_words;
+  if (job.prefix == ADDRESS_BASE58_PREFIX_AEON)
+  {
+    crypto::AeonWords::bytes_to_words(record.spend_key, electrum_words);
+  }
+  else
+  {
+    crypto::ElectrumWords::bytes_to_words(record.spend_key, electrum_words, "English");
+  }
+  append_match(out, job.format, record, job.prefix_label, electrum_words);
+}
+
 //--------------------------------------------------------------------------------
-bool start_search(const std::vector<std::string> &args)
+
+//Counts a match against its job.  Returns false if the word had already
+//filled its quota, in which case retire is set.  Called under my_output_lock.
+bool count_match(search_job& job, const match_record& record, bool& retire)
 {
-  int  search_num_threads;
-  bool single_word_search = false;
-  std::string search_word;
+  //Matches of a word can still be queued after the one that filled its quota,
+  //or a reload brought the word back.  Either way it should leave the index.
+  if (quota_reached(record.word, record.quota, job.word_hit_counts))
+  {
+    retire = true;
+    return false;
+  }
+  uint64_t hits = ++job.word_hit_counts[record.word];
+  job.found_this_search.insert(record.word);
+  job.matches_this_search++;
+  job_matches++;
+  retire = (record.quota != 0 && hits >= record.quota);
+  return true;
+}
 
-  if (search_active)
+//--------------------------------------------------------------------------------
+
+//Writer thread only.  Returns true if the match was written; retire is set
+//when the word has reached its quota.
+bool save_data(search_job& job, const match_record& record, bool& retire)
+{
+  boost::lock_guard<boost::mutex> lock(my_output_lock);
+
+  if (!count_match(job, record, retire)) return false;
+
+  job.found_words[record.word].push_back(record.address);
+
+  //Written out by the writer as the durability policy says
+  static std::string text;
+  text.clear();
+  write_match(text, job, record);
+  uint32_t sync_length = current_durability.sync_length;
+  job.output.add(text, sync_length != 0 && record.word.length() >= sync_length);
+
+  if (options::show_success_msg)
+  {
+    success_msg_writer() << "\rMatch found for \"" << record.word << "\" (" << job.name << "): " << record.address << std::endl;
+    m_cmd_binder.print_prompt();
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//Top-K mode: the output file only ever holds the retained matches, so it is
+//rewritten to a temporary file and renamed over the old one.  Writer thread
+//only, outside my_output_lock.
+void write_retained_output(search_job& job, const std::vector<match_record>& records)
+{
+  std::string tmp_filename = job.output_filename + ".tmp";
+  batched_output tmp_output;
+  if (!tmp_output.open(tmp_filename, true))
+  {
+    fail_msg_writer() << "could not open " << tmp_filename << " for writing" << std::endl;
+    return;
+  }
+  std::string text;
+  append_header(text, job.format);
+  for (const auto & x : job.log_word_ids) append_log_word(text, x.second, x.first);
+  for (const match_record & x : records) write_match(text, job, x);
+  tmp_output.add(text, false);
+  if (!tmp_output.flush(current_durability.fsync))
+  {
+    fail_msg_writer() << "could not write " << tmp_filename << std::endl;
+    return;
+  }
+  tmp_output.close();
+  if (std::rename(tmp_filename.c_str(), job.output_filename.c_str()) != 0)
+  {
+    fail_msg_writer() << "could not replace " << job.output_filename << std::endl;
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+//Top-K counterpart of save_data, writer thread only.  Every match is counted,
+//whether or not it is retained.  Returns true if it was retained; retire is
+//set when the word has reached its quota.
+bool retain_match(search_job& job, const match_record& x, bool& retire)
+{
+  boost::lock_guard<boost::mutex> lock(my_output_lock);
+
+  if (!count_match(job, x, retire) || !job.retained_set.offer(x)) return false;
+
+  if (options::show_success_msg)
+  {
+    success_msg_writer() << "\rMatch retained for \"" << x.word << "\" (" << job.name << "): " << x.address << std::endl;
+    m_cmd_binder.print_prompt();
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+int64_t steady_ms()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//--------------------------------------------------------------------------------
+
+//Drains the match queue until stop_writer is called.  Buffered output goes
+//to disk as current_durability says, and in top-K mode the file is rewritten
+//once per job per drain rather than once per match.
+void match_writer()
+{
+  bool top_k = (options::retention != retention_mode::all);
+  queued_match queued;
+  std::set<std::shared_ptr<search_job>> buffered;  //Jobs with records not yet written
+  std::set<std::shared_ptr<search_job>> failing;   //Reported once until a write works again
+
+  while (true)
+  {
+    //Checked before draining so that matches queued before the stop are written
+    bool stopping = !writer_running.load(std::memory_order_acquire);
+
+    std::map<std::shared_ptr<search_job>, std::unordered_set<std::string>> retiring;
+    std::set<std::shared_ptr<search_job>> written;
+    while (match_queue.try_pop(queued))
+    {
+      //Workers keep finding matches until they are parked, but a match limit
+      //is exact
+      if (current_limits.matches != 0 && job_matches >= current_limits.matches) continue;
+
+      bool retire  = false;
+      bool changed = top_k ? retain_match(*queued.job, queued.record, retire) : save_data(*queued.job, queued.record, retire);
+      if (changed) written.insert(queued.job);
+      if (retire)  retiring[queued.job].insert(queued.record.word);
+    }
+    queued.job.reset();
+
+    if (top_k)
+    {
+      for (const auto & job : written)
+      {
+        std::vector<match_record> records;
+        {
+          boost::lock_guard<boost::mutex> lock(my_output_lock);
+          records = job->retained_set.sorted_records();
+          job->found_words.clear();
+          for (const match_record & x : records) job->found_words[x.word].push_back(x.address);
+        }
+        write_retained_output(*job, records);
+      }
+    }
+    else
+    {
+      //A checkpoint waits for everything queued before it to be synced
+      uint64_t handled  = match_queue.popped();
+      uint64_t target   = writer_sync_request.load(std::memory_order_acquire);
+      bool     sync_now = (target > writer_synced.load(std::memory_order_relaxed) && handled >= target);
+
+      //The buffers are the writer's own, so the disk writes happen outside
+      //my_output_lock
+      buffered.insert(written.begin(), written.end());
+      int64_t now_ms = steady_ms();
+      for (auto it = buffered.begin(); it != buffered.end(); )
+      {
+        search_job & job = **it;
+        bool ok = (stopping || sync_now) ? job.output.flush(current_durability.fsync || sync_now)
+                                         : job.output.flush_if_due(current_durability, now_ms);
+        if (!ok && failing.insert(*it).second)
+        {
+          fail_msg_writer() << "\rcould not write to " << job.output_filename << ", keeping the matches buffered" << std::endl;
+          m_cmd_binder.print_prompt();
+        }
+        else if (ok)
+        {
+          failing.erase(*it);
+        }
+        it = (job.output.pending() == 0) ? buffered.erase(it) : std::next(it);
+      }
+      if (sync_now && buffered.empty()) writer_synced.store(handled, std::memory_order_release);
+    }
+    for (const auto & x : retiring)
+    {
+      for (const std::string & word : x.second) retire_word(*x.first, word);
+    }
+
+    if (stopping) return;
+    if (written.empty()) std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_IDLE_MS));
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+void start_writer()
+{
+  writer_running = true;
+  writer_thread = std::thread(match_writer);
+}
+
+//--------------------------------------------------------------------------------
+
+//Call once the workers are parked so nothing is queued after the last drain
+void stop_writer()
+{
+  if (!writer_thread.joinable()) return;
+  writer_running = false;
+  writer_thread.join();
+}
+
+//--------------------------------------------------------------------------------
+
+//Only waits if the writer has fallen a whole ring behind
+void queue_match(const std::shared_ptr<search_job>& job, match_record&& record)
+{
+  queued_match queued {job, std::move(record)};
+  while (!match_queue.try_push(std::move(queued))) std::this_thread::yield();
+}
+
+//--------------------------------------------------------------------------------
+
+//The node's copy of the job's index for generation gen, building it if this
+//thread gets there first.  Returns nullptr while another thread is building it.
+std::shared_ptr<const word_index> node_replica(search_job& job, int node, uint64_t gen, const std::shared_ptr<const word_index>& master)
+{
+  index_replica & replica = *job.index_replicas[node];
+  boost::unique_lock<boost::mutex> lock(replica.lock, boost::try_to_lock);
+  if (!lock.owns_lock()) return nullptr;
+
+  if (replica.generation != gen || !replica.index)
+  {
+    replica.index      = replicate_index(master, replica.parts);
+    replica.generation = gen;
+  }
+  return replica.index;
+}
+
+//--------------------------------------------------------------------------------
+
+//Refreshes load_scale at most every LOAD_CHECK_SECONDS.  Above the limit the
+//duty shrinks in proportion to the excess load.
+void check_load()
+{
+  double limit = options::load_limit;
+  if (limit <= 0)
+  {
+    load_scale = 1;
+    return;
+  }
+
+  int64_t now = steady_ms();
+  int64_t due = next_load_check_ms.load(std::memory_order_relaxed);
+  if (now < due || !next_load_check_ms.compare_exchange_strong(due, now + LOAD_CHECK_SECONDS * 1000)) return;
+
+  double load;
+  if (!read_load_average(load)) return;
+  double scale = (load > limit) ? limit / load : 1;
+  load_scale = std::max(scale, MIN_LOAD_SCALE);
+}
+
+//--------------------------------------------------------------------------------
+
+//Fraction of wall time each worker may spend on the CPU
+double target_duty()
+{
+  double duty = 1;
+  uint32_t budget = options::cpu_budget;
+  if (budget != 0)
+  {
+    uint32_t threads = std::max<uint32_t>(active_threads, 1);
+    duty = std::min(1.0, (double) budget / 100 * host_cpu_limits.effective / threads);
+  }
+  return duty * load_scale;
+}
+
+//--------------------------------------------------------------------------------
+
+//A worker's matcher for one job
+struct job_matcher
+{
+  std::shared_ptr<search_job> job;
+  tiered_matcher              matcher;
+  uint64_t                    index_gen   {0};
+  bool                        local_index {false};  //Using this node's replica rather than the job's live index
+};
+
+//--------------------------------------------------------------------------------
+
+//Follows the live job list, keeping the matchers of jobs that are still there
+void sync_matchers(std::vector<job_matcher>& matchers, const job_list& jobs)
+{
+  std::vector<job_matcher> synced;
+  for (const auto & job : jobs)
+  {
+    auto found = std::find_if(matchers.begin(), matchers.end(), [&](const job_matcher& x) { return x.job == job; });
+    if (found != matchers.end())
+    {
+      synced.push_back(std::move(*found));
+      found->job.reset();
+      continue;
+    }
+    synced.emplace_back();
+    synced.back().job = job;
+  }
+  matchers.swap(synced);
+}
+
+//--------------------------------------------------------------------------------
+
+//Replans the matcher when its job has a new index, or when this thread can now
+//use its node's replica
+void refresh_matcher(job_matcher& x, int node)
+{
+  uint64_t current_gen  = x.job->index_generation.load(std::memory_order_acquire);
+  bool     want_replica = (node >= 0 && (size_t) node < x.job->index_replicas.size());
+  if (current_gen == x.index_gen && x.matcher.get_index() && (x.local_index || !want_replica)) return;
+
+  x.index_gen = current_gen;
+  std::shared_ptr<const word_index> index = std::atomic_load(&x.job->live_index);
+  std::shared_ptr<const word_index> replica;
+  if (want_replica) replica = node_replica(*x.job, node, current_gen, index);
+  x.local_index = (replica != nullptr);
+  x.matcher.plan(x.local_index ? replica : index, x.job->prefix);
+}
+
+//--------------------------------------------------------------------------------
+
+//Runs one search on a pool thread until the pool is parked.  The account and
+//matchers belong to the thread and carry over from one search to the next.
+//Each candidate key is tested against every job.
+void run_search_job(const uint32_t thread_num, const int node, const job_settings job, worker_progress& progress,
+                    trim_account& m_account, std::vector<job_matcher>& matchers)
+{
+  if (progress.search_id != job.search_id) progress = worker_progress {job.search_id, 0, 0};
+
+  uint64_t num_searches = 0;
+  auto start_time = Clock::now();
+
+  std::vector<word_match> matches;
+  uint64_t jobs_gen   = 0;
+  bool     jobs_known = false;
+
+  duty_cycle        throttle;
+  worker_counters & counters = worker_stats[thread_num];
+
+  while(pool_state.load(std::memory_order_acquire) == worker_state::running
+        && thread_num < active_threads.load(std::memory_order_relaxed))
+  {
+    uint64_t current_jobs_gen = jobs_generation.load(std::memory_order_acquire);
+    if (!jobs_known || current_jobs_gen != jobs_gen)
+    {
+      jobs_gen   = current_jobs_gen;
+      jobs_known = true;
+      sync_matchers(matchers, *std::atomic_load(&live_jobs));
+    }
+    for (job_matcher & x : matchers) refresh_matcher(x, node);
+
+    uint64_t batch = 0;
+    if (job.walk && !key_batches.next(thread_num, batch))
+    {
+      //Walk handed out.  The stats thread ends the search once the last
+      //batches are done.
+      std::this_thread::sleep_for(std::chrono::milliseconds(WALK_IDLE_MS));
+      continue;
+    }
+
+    for (uint32_t i=0; i<job.batch_size; i++)
+    {
+      if (job.walk && i == 0) m_account.seek_spend_key(walk_batch_key(walk_base_key, batch), 0);
+      else m_account.increment_spend_key();
+
+      //--------------------------------
+      bool found = false;
+      for (job_matcher & x : matchers)
+      {
+        if (!x.matcher.evaluate(m_account, matches) || job.trial) continue;
+
+        found = true;
+        std::string public_address_string = x.matcher.full_address(m_account);
+        counters.matches.store(counters.matches.load(std::memory_order_relaxed) + matches.size(), std::memory_order_relaxed);
+        counters.last_match_ms.store(steady_ms(), std::memory_order_relaxed);
+        for (const word_match & m : matches)
+        {
+          queue_match(x.job, make_match_record(x.matcher.word(m.word_id), public_address_string, m.start_pos, m_account, thread_num));
+        }
+      }
+      if (found && !job.walk) m_account.random_keys();
+      //--------------------------------
+    }
+    if (job.walk) key_batches.batch_done(thread_num);
+    num_searches += job.batch_size;
+    counters.addresses.store(counters.addresses.load(std::memory_order_relaxed) + job.batch_size, std::memory_order_relaxed);
+
+    if (!job.trial)
+    {
+      check_load();
+      double pause = throttle.pause_for(target_duty(), MAX_THROTTLE_PAUSE);
+      if (pause > 0) std::this_thread::sleep_for(std::chrono::duration<double>(pause));
+    }
+  }
+
+  job_addresses_checked.fetch_add(num_searches);
+  progress.num_searches += num_searches;
+  progress.seconds      += ((double) std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now()-start_time).count())/1000;
+}
+
+//--------------------------------------------------------------------------------
+
+void search_thread(const uint32_t thread_num)
+{
+  trim_account             m_account;
+  std::vector<job_matcher> matchers;
+  int                      node     = -1;
+  job_settings             job;
+  worker_progress *        progress = nullptr;
+
+  while (true)
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(pool_lock);
+      while (pool_state != worker_state::exiting && (pool_state != worker_state::running || thread_num >= job_num_threads))
+      {
+        pool_cv.wait(lock);
+      }
+      if (pool_state == worker_state::exiting) return;
+      workers_running++;
+      node     = worker_nodes[thread_num];
+      job      = current_job;
+      progress = &worker_progress_slots[thread_num];
+    }
+
+    run_search_job(thread_num, node, job, *progress, m_account, matchers);
+
+    {
+      boost::lock_guard<boost::mutex> lock(pool_lock);
+      workers_running--;
+
+      //Removed by the threads command: hand the counters over to the search
+      //totals and start from fresh keys if added back later
+      if (thread_num >= job_num_threads && progress->search_id == current_job.search_id)
+      {
+        retired_progress.num_searches += progress->num_searches;
+        retired_progress.seconds      += progress->seconds;
+        *progress = worker_progress {current_job.search_id, 0, 0};
+        m_account.random_keys();
+      }
+    }
+    pool_cv.notify_all();
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+//Pins workers first to last-1 following the placement and fills in the NUMA
+//node of each one that was pinned
+void pin_workers(uint32_t first, uint32_t last, placement_policy placement, const std::vector<uint32_t>& placement_list, std::vector<int>& nodes)
+{
+  if (placement == placement_policy::none)
+  {
+    for (uint32_t i=first; i<last; i++) unpin_thread(search_threads[i]);
+    return;
+  }
+
+  std::vector<cpu_info> topology = read_cpu_topology();
+  std::vector<uint32_t> cpus     = placement_cpus(placement, topology, placement_list);
+  if (cpus.empty())
+  {
+    fail_msg_writer() << "could not read the CPU topology or none of the CPUs are allowed, threads are not pinned" << std::endl;
+    return;
+  }
+
+  std::map<uint32_t, uint32_t> cpu_nodes;
+  for (const cpu_info & x : topology) cpu_nodes[x.cpu] = x.node;
+
+  std::stringstream ss;
+  ss << "Placement " << placement_name(placement) << ", thread -> CPU:";
+  for (uint32_t i=first; i<last; i++)
+  {
+    uint32_t cpu = cpus[i % cpus.size()];
+    ss << " " << i << "->" << cpu;
+    if (!pin_thread(search_threads[i], cpu)) ss << "(failed)";
+    else if (cpu_nodes.count(cpu)) nodes[i] = cpu_nodes[cpu];
+  }
+  std::cout << ss.str() << std::endl;
+}
+
+//--------------------------------------------------------------------------------
+
+//Pins the workers and decides which NUMA node each one takes its index from.
+//Only called while the pool is parked.
+void place_workers(uint32_t num_threads, placement_policy placement, const std::vector<uint32_t>& placement_list)
+{
+  std::vector<int> nodes(search_threads.size(), -1);
+  std::shared_ptr<const job_list> jobs = std::atomic_load(&live_jobs);
+  for (const auto & x : *jobs) x->index_replicas.clear();
+  replica_nodes      = 0;
+  job_placement      = placement;
+  job_placement_list = placement_list;
+  pin_workers(0, num_threads, placement, placement_list, nodes);
+
+  //Replicate only when the pinned workers actually span several nodes
+  std::set<int> used_nodes(nodes.begin(), nodes.begin() + num_threads);
+  used_nodes.erase(-1);
+  if (used_nodes.size() < 2)
+  {
+    std::fill(nodes.begin(), nodes.end(), -1);
+  }
+  else
+  {
+    replica_nodes = *used_nodes.rbegin() + 1;
+    size_t index_bytes = 0;
+    for (const auto & x : *jobs)
+    {
+      x->index_replicas.resize(replica_nodes);
+      for (auto & replica : x->index_replicas) replica.reset(new index_replica());
+      index_bytes += index_memory_bytes(*std::atomic_load(&x->live_index));
+    }
+
+    double replica_mb = (double) index_bytes / (1024 * 1024);
+    std::cout << "NUMA: word indexes replicated on " << used_nodes.size() << " nodes, about "
+              << replica_mb << " MB per node (" << replica_mb * used_nodes.size() << " MB total)" << std::endl;
+  }
+
+  boost::lock_guard<boost::mutex> lock(pool_lock);
+  worker_nodes = nodes;
+}
+
+//--------------------------------------------------------------------------------
+
+//Sets the parked workers going again on the current search
+void resume_workers()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(pool_lock);
+    pool_state = worker_state::running;
+  }
+  pool_cv.notify_all();
+}
+
+//--------------------------------------------------------------------------------
+
+//Starts a new search on the pool, spawning threads if it is too small
+void spawn_workers(uint32_t num_threads)
+{
+  while (search_threads.size() < num_threads)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(pool_lock);
+      worker_progress_slots.push_back(worker_progress {0, 0, 0});
+      worker_nodes.push_back(-1);
+    }
+    search_threads.push_back(std::thread(search_thread, search_threads.size()));
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+//Starts a new search on the pool, spawning threads if it is too small.  A
+//key-space walk carries on from restore if given.
+void run_workers(uint32_t num_threads, placement_policy placement, const std::vector<uint32_t>& placement_list, bool trial = false,
+                 const walk_snapshot* restore = nullptr)
+{
+  spawn_workers(num_threads);
+  place_workers(num_threads, placement, placement_list);
+
+  bool walk = options::walk && !trial;
+  if (walk)
+  {
+    uint64_t num_batches = (options::walk_keys + options::batch_size - 1) / options::batch_size;
+    if (restore) key_batches.restore(num_threads, num_batches, WALK_CHUNK_BATCHES, *restore);
+    else key_batches.start(num_threads, num_batches, WALK_CHUNK_BATCHES);
+  }
+  else
+  {
+    key_batches.stop();
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(pool_lock);
+    job_num_threads  = num_threads;
+    active_threads   = num_threads;
+    current_job      = job_settings {current_job.search_id + 1, options::batch_size, trial, walk};
+    retired_progress = worker_progress {current_job.search_id, 0, 0};
+    job_addresses_checked = 0;
+  }
+  for (worker_counters & x : worker_stats)
+  {
+    x.addresses     = 0;
+    x.matches       = 0;
+    x.last_match_ms = 0;
+  }
+  resume_workers();
+}
+
+//--------------------------------------------------------------------------------
+
+//Grows or shrinks the current search.  Extra workers leave at their next
+//batch; new ones start from fresh random keys, or steal batches of a
+//key-space walk.
+void resize_workers(uint32_t num_threads)
+{
+  uint32_t old_num_threads;
+  {
+    boost::lock_guard<boost::mutex> lock(pool_lock);
+    old_num_threads = job_num_threads;
+  }
+
+  spawn_workers(num_threads);
+  key_batches.add_threads(num_threads);
+  if (num_threads > old_num_threads)
+  {
+    std::vector<int> nodes(search_threads.size(), -1);
+    pin_workers(old_num_threads, num_threads, job_placement, job_placement_list, nodes);
+
+    boost::lock_guard<boost::mutex> lock(pool_lock);
+    for (uint32_t i=old_num_threads; i<num_threads; i++)
+    {
+      //Only take a NUMA copy of the index if one is being kept for that node
+      worker_nodes[i] = (nodes[i] >= 0 && (size_t) nodes[i] < replica_nodes) ? nodes[i] : -1;
+    }
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(pool_lock);
+    job_num_threads = num_threads;
+    active_threads  = num_threads;
+
+    //Parked workers are not running a batch, so hand over their counters here
+    if (pool_state == worker_state::parked)
+    {
+      for (uint32_t i=num_threads; i<old_num_threads; i++)
+      {
+        worker_progress & progress = worker_progress_slots[i];
+        if (progress.search_id != current_job.search_id) continue;
+        retired_progress.num_searches += progress.num_searches;
+        retired_progress.seconds      += progress.seconds;
+        progress = worker_progress {current_job.search_id, 0, 0};
+      }
+    }
+  }
+  pool_cv.notify_all();
+}
+
+//--------------------------------------------------------------------------------
+
+//Returns once every worker has finished its current batch and parked
+void park_workers()
+{
+  boost::unique_lock<boost::mutex> lock(pool_lock);
+  pool_state = worker_state::parked;
+  while (workers_running != 0) pool_cv.wait(lock);
+}
+
+//--------------------------------------------------------------------------------
+
+void shutdown_workers()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(pool_lock);
+    pool_state = worker_state::exiting;
+  }
+  pool_cv.notify_all();
+  for (size_t i=0;i<search_threads.size(); i++) search_threads[i].join();
+  search_threads.clear();
+}
+
+//--------------------------------------------------------------------------------
+
+//Addresses/sec of each thread between two samples
+std::vector<double> sample_rates(const stats_sample& from, const stats_sample& to)
+{
+  double seconds = std::chrono::duration<double>(to.time - from.time).count();
+  std::vector<double> rates(to.addresses.size(), 0);
+  for (size_t i=0; i<to.addresses.size() && seconds > 0; i++)
+  {
+    uint64_t before = (i < from.addresses.size()) ? from.addresses[i] : 0;
+    rates[i] = (to.addresses[i] >= before) ? (to.addresses[i] - before) / seconds : 0;
+  }
+  return rates;
+}
+
+//--------------------------------------------------------------------------------
+
+stats_sample take_stats_sample()
+{
+  stats_sample sample;
+  sample.time    = Clock::now();
+  sample.matches = 0;
+  size_t pool_size;
+  {
+    boost::lock_guard<boost::mutex> lock(pool_lock);
+    pool_size = worker_progress_slots.size();
+  }
+  for (size_t i=0; i<pool_size; i++)
+  {
+    sample.addresses.push_back(worker_stats[i].addresses.load(std::memory_order_relaxed));
+    sample.matches += worker_stats[i].matches.load(std::memory_order_relaxed);
+  }
+  return sample;
+}
+
+//--------------------------------------------------------------------------------
+
+std::string format_walk_progress()
+{
+  std::stringstream ss;
+  ss << "Key space: " << key_batches.batches_done();
+  if (key_batches.num_batches() != 0)
+  {
+    ss << " of " << key_batches.num_batches() << " batches walked ("
+       << std::fixed << std::setprecision(1) << 100.0 * key_batches.batches_done() / key_batches.num_batches() << "%)";
+  }
+  else
+  {
+    ss << " batches walked";
+  }
+  ss << ", " << key_batches.batches_stolen() << " stolen";
+  return ss.str();
+}
+
+//--------------------------------------------------------------------------------
+
+//Current rate is over the last sample, rolling rate over the last
+//STATS_WINDOW_SECONDS.  Reads the counters without stopping the workers.
+std::string format_stats()
+{
+  std::vector<stats_sample> samples;
+  {
+    boost::lock_guard<boost::mutex> lock(stats_lock);
+    if (stats_samples.empty()) return "No stats yet";
+    samples.push_back(stats_samples.front());
+    if (stats_samples.size() > 1) samples.push_back(stats_samples[stats_samples.size() - 2]);
+    samples.push_back(stats_samples.back());
+  }
+  const stats_sample & oldest = samples.front();
+  const stats_sample & latest = samples.back();
+  std::vector<double> current = sample_rates(samples[samples.size() - 2], latest);
+  std::vector<double> rolling = sample_rates(oldest, latest);
+  double window = std::chrono::duration<double>(latest.time - oldest.time).count();
+
+  uint32_t num_threads = active_threads;
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(0)
+     << "Thread      Now/sec   " << std::setw(3) << (int) window << "s avg/sec      Total checked\n";
+  double   total_current = 0, total_rolling = 0;
+  uint64_t total_checked = 0;
+  for (size_t i=0; i<latest.addresses.size(); i++)
+  {
+    total_current += current[i];
+    total_rolling += rolling[i];
+    total_checked += latest.addresses[i];
+    if (i >= num_threads) continue;
+    ss << std::left << std::setw(8) << i << std::right
+       << std::setw(11) << current[i] << std::setw(15) << rolling[i] << std::setw(19) << latest.addresses[i] << "\n";
+  }
+  ss << std::left << std::setw(8) << "Total" << std::right
+     << std::setw(11) << total_current << std::setw(15) << total_rolling << std::setw(19) << total_checked << "\n";
+
+  int64_t last_match_ms = 0;
+  for (size_t i=0; i<latest.addresses.size(); i++) last_match_ms = std::max<int64_t>(last_match_ms, worker_stats[i].last_match_ms.load(std::memory_order_relaxed));
+  double matches_per_sec = (window > 0) ? (latest.matches - oldest.matches) / window : 0;
+
+  ss << std::setprecision(2) << "Matches: " << latest.matches << " (" << matches_per_sec << "/sec), ";
+  if (last_match_ms == 0) ss << "none yet";
+  else ss << std::setprecision(0) << "last " << (steady_ms() - last_match_ms) / 1000.0 << "s ago";
+  ss << ".  Writer queue: " << match_queue.size() << (search_paused ? ".  Paused" : "");
+  if (key_batches.active()) ss << "\n" << format_walk_progress();
+  return ss.str();
+}
+
+//--------------------------------------------------------------------------------
+
+//The reason the current job should end, or an empty string
+std::string job_limit_reached()
+{
+  if (key_batches.finished())
+  {
+    return "key space walked";
+  }
+  if (current_limits.matches != 0 && job_matches >= current_limits.matches)
+  {
+    return std::to_string(current_limits.matches) + " matches written";
+  }
+  if (current_limits.wall_seconds != 0
+      && std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - job_start_time).count() >= current_limits.wall_seconds)
+  {
+    return "time limit of " + std::to_string(current_limits.wall_seconds) + " seconds";
+  }
+  if (current_limits.cpu_seconds != 0 && process_cpu_seconds() - job_start_cpu >= current_limits.cpu_seconds)
+  {
+    return "CPU time limit of " + std::to_string(current_limits.cpu_seconds) + " seconds";
+  }
+  if (current_limits.all_words)
+  {
+    //A word list can repeat a word, and keeps the words retired at their
+    //quota, so each word is looked up.  A word retired in an earlier search
+    //can't be found in this one and is skipped.
+    std::shared_ptr<const job_list> jobs = std::atomic_load(&live_jobs);
+    for (const auto & job : *jobs)
+    {
+      if (job->stream_running) return "";  //More words may be on the way
+      std::shared_ptr<const word_index> index = std::atomic_load(&job->live_index);
+      boost::lock_guard<boost::mutex> lock(my_output_lock);
+      for (const word_index * part : index_parts(*index))
+      {
+        for (const word_entry & x : *part->words)
+        {
+          if (job->found_this_search.count(x.word) || quota_reached(x.word, x.quota, job->word_hit_counts)) continue;
+          return "";
+        }
+      }
+    }
+    return "every word found";
+  }
+  return "";
+}
+
+//--------------------------------------------------------------------------------
+
+void stop_at_limit(const std::string& reason);
+bool write_checkpoint(const std::string& filename);
+
+//--------------------------------------------------------------------------------
+
+//Samples the counters once a second while a search is active and prints them
+//every stats_report_seconds if set.  Also ends the search at a job limit.
+void stats_reporter()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(stats_lock);
+    stats_samples.clear();
+    stats_samples.push_back(take_stats_sample());
+  }
+  uint32_t seconds = 0;
+  while (stats_running)
+  {
+    for (int i=0; i<10 && stats_running; i++) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (!stats_running) break;
+    {
+      boost::lock_guard<boost::mutex> lock(stats_lock);
+      stats_samples.push_back(take_stats_sample());
+      if (stats_samples.size() > STATS_WINDOW_SECONDS + 1) stats_samples.pop_front();
+    }
+
+    seconds++;
+    uint32_t report_seconds = stats_report_seconds;
+    if (report_seconds != 0 && seconds % report_seconds == 0 && !search_paused)
+    {
+      thread_safe_print("\r" + format_stats());
+      m_cmd_binder.print_prompt();
+    }
+
+    uint32_t every = checkpoint_seconds;
+    if (every != 0 && seconds % every == 0)
+    {
+      boost::lock_guard<boost::mutex> lock(checkpoint_lock);
+      if (!checkpoint_filename.empty() && !write_checkpoint(checkpoint_filename)) m_cmd_binder.print_prompt();
+    }
+
+    std::string reason = job_limit_reached();
+    if (!reason.empty())
+    {
+      stop_at_limit(reason);
+      return;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+void start_stats()
+{
+  if (stats_thread.joinable()) stats_thread.join();
+  stats_running = true;
+  stats_thread  = std::thread(stats_reporter);
+}
+
+//--------------------------------------------------------------------------------
+
+//When a job limit stops the search the stats thread ends itself, and is
+//joined on the next start instead
+void stop_stats()
+{
+  stats_running = false;
+  if (stats_thread.joinable() && stats_thread.get_id() != std::this_thread::get_id()) stats_thread.join();
+}
+
+//--------------------------------------------------------------------------------
+
+//Opens the job's output file, truncating it or appending to it.  In top-K
+//mode the file is rewritten whole by the writer, so it is only checked for
+//being writable here.  A binary log is appended to after its last whole
+//record, so a record torn by a crash doesn't corrupt the ones that follow.
+bool open_job_output(search_job& job, bool truncate)
+{
+  job.log_word_ids.clear();
+  bool append_log = options::format == output_format::binary && !truncate && options::retention == retention_mode::all;
+  uint64_t complete_bytes = 0;
+  if (append_log && !load_log_word_ids(job.output_filename, job.log_word_ids, complete_bytes))
+  {
+    fail_msg_writer() << job.output_filename << " is not a binary match log, it can't be appended to" << std::endl;
+    return false;
+  }
+  if (!job.output.open(job.output_filename, truncate))
+  {
+    fail_msg_writer() << "could not open " << job.output_filename << " for writing" << std::endl;
+    return false;
+  }
+  if (append_log && complete_bytes > 0 && job.output.file_size() > complete_bytes && !job.output.truncate_to(complete_bytes))
+  {
+    fail_msg_writer() << "could not cut the partial record off the end of " << job.output_filename << std::endl;
+    job.output.close();
+    return false;
+  }
+  job.format = options::format;
+  if (job.output.file_size() == 0)
+  {
+    std::string header;
+    append_header(header, job.format);
+    if (!header.empty()) job.output.add(header, false);
+  }
+  if (options::retention != retention_mode::all)
+  {
+    job.output.close();
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//Enough of a hash of a secret key to tell keys apart, without showing the key
+std::string key_fingerprint(const crypto::secret_key& key)
+{
+  crypto::hash hash = crypto::cn_fast_hash(&key, sizeof(key));
+  return epee::string_tools::pod_to_hex(hash).substr(0, 16);
+}
+
+//--------------------------------------------------------------------------------
+
+bool parse_prefix(const std::string& arg, uint64_t& prefix, std::string& label)
+{
+  auto muh_prefix = prefix_map.find(boost::to_upper_copy(arg));
+  if (muh_prefix != prefix_map.end())
+  {
+    prefix = muh_prefix->second;
+    label  = muh_prefix->first;
+    return true;
+  }
+  try{
+    prefix = boost::lexical_cast<uint64_t>(arg);
+    label  = "NA";
+    return true;
+  }
+  catch(boost::bad_lexical_cast& e){
+    return false;
+  }
+}
+
+//Starts the workers, writer and stats thread on the published jobs, whose
+//outputs are already open.  A resumed search carries on from the checkpoint's
+//counters and walk.
+void launch_search(uint32_t num_threads, placement_policy placement, const std::vector<uint32_t>& placement_list,
+                   const search_checkpoint* checkpoint = nullptr)
+{
+  if (num_threads > host_cpu_limits.effective)
+  {
+    std::cout << "Warning: " << num_threads << " threads requested but only " << host_cpu_limits.effective
+              << " CPUs are available to this process" << std::endl;
+  }
+  size_t num_jobs = std::atomic_load(&live_jobs)->size();
+  std::cout << (checkpoint ? "Resuming" : "Starting") << " vanity search with " << num_threads << " threads"
+            << (num_jobs > 1 ? " for " + std::to_string(num_jobs) + " jobs" : std::string()) << "..." << std::endl;
+  search_active=true;
+  searches_started++;
+  current_limits     = options::limits;
+  current_durability = options::durability;
+  job_matches    = checkpoint ? checkpoint->matches : 0;
+  job_start_time = Clock::now();
+  job_start_cpu  = process_cpu_seconds();
+  {
+    boost::lock_guard<boost::mutex> lock(my_output_lock);
+    for (const auto & x : *std::atomic_load(&live_jobs))
+    {
+      x->found_this_search.clear();
+      x->matches_this_search = 0;
+      if (!checkpoint) continue;
+      for (const auto & hits : x->word_hit_counts)
+      {
+        x->found_this_search.insert(hits.first);
+        x->matches_this_search += hits.second;
+      }
+    }
+  }
+  if (options::walk)
+  {
+    walk_base_key = options::walk_random_base ? trim_account().get_raw_private_spend_key() : options::walk_base;
+    std::cout << "Walking the key space from the base key with fingerprint " << key_fingerprint(walk_base_key);
+    if (options::walk_keys != 0) std::cout << ", " << options::walk_keys << " keys";
+    std::cout << ", batches of " << options::batch_size << std::endl;
+  }
+  start_writer();
+  run_workers(num_threads, placement, placement_list, false, (checkpoint && checkpoint->walk) ? &checkpoint->walk_state : nullptr);
+  {
+    boost::lock_guard<boost::mutex> lock(pool_lock);
+    resumed_progress = checkpoint ? worker_progress {current_job.search_id, checkpoint->addresses, checkpoint->seconds}
+                                  : worker_progress {current_job.search_id, 0, 0};
+  }
+  start_stats();
+}
+
+//--------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------
+//
+//COMMANDS
+//
+//--------------------------------------------------------------------------------
+bool start_search(const std::vector<std::string> &args)
+{
+  boost::lock_guard<boost::mutex> control_lock(search_control_lock);
+  int  search_num_threads;
+  placement_policy      placement = placement_policy::none;
+  std::vector<uint32_t> placement_list;
+
+  if (search_active)
+  {
+    std::cout << "Search is already active.  No action taken." << std::endl;
+    return true;
+  }
+
+  //start jobs [threads] [placement] runs the jobs added with the job command,
+  //otherwise the word file and output file define the default job
+  bool   jobs_only  = (!args.empty() && boost::to_lower_copy(args[0]) == "jobs");
+  size_t thread_arg = jobs_only ? 1 : 2;
+
+  if (!jobs_only && args.size() < 2)
+  {
+    fail_msg_writer() << "Need <word file> or <word> and <output file> arguments, or jobs" << std::endl;
+    return true;
+  }
+  else if (jobs_only && std::atomic_load(&live_jobs)->empty())
+  {
+    fail_msg_writer() << "No jobs to run, add some with job add" << std::endl;
+    return true;
+  }
+  else if (args.size() > thread_arg + 1 && !parse_placement(args[thread_arg + 1], placement, placement_list))
+  {
+    fail_msg_writer() << "Expected placement compact, scatter, physical, none or a CPU list such as 0,2,4-7" << std::endl;
+    return true;
+  }
+  else
+  {
+    try
+    {
+      std::shared_ptr<search_job> default_job;
+      if (!jobs_only)
+      {
+        //Reused rather than replaced so that its hit counts and results carry
+        //over from one start to the next, as they always have
+        default_job = find_job(DEFAULT_JOB_NAME);
+        if (!default_job)
+        {
+          default_job = make_job(DEFAULT_JOB_NAME, args[0], args[1], options::address_prefix, options::address_prefix_label, options::word_quota);
+          auto jobs = std::make_shared<job_list>(*std::atomic_load(&live_jobs));
+          jobs->push_back(default_job);
+          publish_jobs(jobs);
+        }
+        default_job->word_source     = args[0];
+        default_job->output_filename = args[1];
+        default_job->prefix          = options::address_prefix;
+        default_job->prefix_label    = options::address_prefix_label;
+        default_job->quota           = options::word_quota;
+        if (!load_job_words(*default_job)) return true;
+      }
+
+      //The default job's output starts afresh, added jobs keep what earlier
+      //searches wrote
+      for (const auto & x : *std::atomic_load(&live_jobs))
+      {
+        if (!open_job_output(*x, x == default_job)) return true;
+      }
+    }
+    catch (std::exception &e)
+    {
+      fail_msg_writer() << "exception while opening files: " << e.what() << std::endl;
+      return true;
+    }
+    if (args.size() > thread_arg)
+    {
+      try
+      {
+        search_num_threads = boost::lexical_cast<int>(args[thread_arg]);
+      }
+      catch(boost::bad_lexical_cast& e)
+      {
+        std::cout << "Could not parse number of threads" << std::endl
+                  << "Using default number of threads (" << options::num_threads << ")" << std::endl;
+        search_num_threads = options::num_threads;
+      }
+      if (search_num_threads < 0){
+        std::cout << "Positive number of threads required" << std::endl;
+        return true;
+      }
+      if (search_num_threads > MAX_SEARCH_THREADS){
+        std::cout << "At most " << MAX_SEARCH_THREADS << " threads are supported" << std::endl;
+        return true;
+      }
+    }
+    else
+    {
+      search_num_threads = options::num_threads;
+    }
+  }
+  launch_search(search_num_threads, placement, placement_list);
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+void print_progress(const std::string& label, const worker_progress& progress)
+{
+  double addresses_per_sec = (progress.seconds > 0) ? (double) progress.num_searches / progress.seconds : 0;
+
+  std::stringstream ss;
+  ss << label << ": \n"
+     << progress.num_searches << " Addresses Checked\n"
+     << progress.seconds      << " Seconds\n"
+     << addresses_per_sec     << " Addresses / Sec on Average" << std::endl;
+  thread_safe_print(ss.str());
+}
+
+//--------------------------------------------------------------------------------
+
+//Only called once the pool is parked
+void print_thread_stats()
+{
+  for (uint32_t i=0; i<job_num_threads; i++)
+  {
+    if (worker_progress_slots[i].search_id != current_job.search_id) continue;
+    print_progress("Thread [" + std::to_string(i) + "]", worker_progress_slots[i]);
+  }
+  if (retired_progress.num_searches != 0) print_progress("Removed threads", retired_progress);
+  if (resumed_progress.num_searches != 0) print_progress("Before resume", resumed_progress);
+}
+
+//--------------------------------------------------------------------------------
+
+//Saves what a later resume needs to carry on the search: the settings, the
+//jobs with their hit counts, the counters and, for a key-space walk, the
+//batches not walked yet.  Matches queued before the walk snapshot are synced
+//to the outputs first, so the outputs hold every match the checkpoint counts.
+//Written to a temporary file and renamed, so a crash leaves the previous
+//checkpoint whole.  Call with checkpoint_lock held.
+bool write_checkpoint(const std::string& filename)
+{
+  if (options::retention != retention_mode::all)
+  {
+    fail_msg_writer() << "\rcheckpoints need retention all, top-K sets are not saved" << std::endl;
+    return false;
+  }
+  for (const auto & x : *std::atomic_load(&live_jobs))
+  {
+    if (is_word_stream(x->word_source))
+    {
+      fail_msg_writer() << "\rjob " << x->name << " reads a word stream, which resume could not read again" << std::endl;
+      return false;
+    }
+  }
+
+  job_settings job;
+  uint32_t     num_threads;
+  worker_progress resumed;
+  {
+    boost::lock_guard<boost::mutex> lock(pool_lock);
+    job         = current_job;
+    num_threads = job_num_threads;
+    resumed     = resumed_progress;
+  }
+  if (job.search_id == 0 || job.trial)
+  {
+    fail_msg_writer() << "\rno search to checkpoint" << std::endl;
+    return false;
+  }
+
+  walk_snapshot walk {0, 0, {}};
+  if (job.walk) walk = key_batches.snapshot();
+
+  if (writer_running)
+  {
+    uint64_t target = match_queue.pushed();
+    writer_sync_request.store(target, std::memory_order_release);
+    auto deadline = Clock::now() + std::chrono::seconds(CHECKPOINT_SYNC_SECONDS);
+    while (writer_synced.load(std::memory_order_acquire) < target)
+    {
+      if (Clock::now() > deadline)
+      {
+        fail_msg_writer() << "\rmatch output not synced within " << CHECKPOINT_SYNC_SECONDS << "s, checkpoint skipped" << std::endl;
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_IDLE_MS));
+    }
+  }
+
+  uint64_t addresses = resumed.num_searches;
+  for (uint64_t x : take_stats_sample().addresses) addresses += x;
+  double seconds = resumed.seconds;
+  seconds += std::chrono::duration<double>((search_active ? Clock::now() : job_stop_time) - job_start_time).count();
+
+  std::stringstream ss;
+  ss << "vanity_checkpoint=1\n"
+     << "threads="            << num_threads                 << "\n"
+     << "batch_size="         << job.batch_size              << "\n"
+     << "min_start_pos="      << options::min_start_pos      << "\n"
+     << "max_start_pos="      << options::max_start_pos      << "\n"
+     << "search_word_length=" << options::search_word_length << "\n"
+     << "format="             << output_format_name(options::format) << "\n"
+     << "walk="               << (job.walk ? 1 : 0)          << "\n"
+     << "limit_matches="      << current_limits.matches      << "\n"
+     << "limit_all_words="    << (current_limits.all_words ? 1 : 0) << "\n"
+     << "limit_time="         << current_limits.wall_seconds << "\n"
+     << "limit_cpu="          << current_limits.cpu_seconds  << "\n";
+  if (job.walk)
+  {
+    ss << "walk_base="    << epee::string_tools::pod_to_hex(walk_base_key) << "\n"
+       << "walk_batches=" << key_batches.num_batches() << "\n"
+       << "walk_next="    << walk.next_batch           << "\n"
+       << "walk_done="    << walk.done                 << "\n";
+    for (const auto & x : walk.ranges) ss << "walk_range=" << x.first << " " << x.second << "\n";
+  }
+  ss << "addresses=" << addresses << "\n"
+     << std::setprecision(15) << "seconds=" << seconds << "\n"
+     << "matches="   << job_matches << "\n";
+
+  for (const auto & x : *std::atomic_load(&live_jobs))
+  {
+    ss << "job="        << x->name            << "\n"
+       << "job_words="  << x->word_source     << "\n"
+       << "job_output=" << x->output_filename << "\n"
+       << "job_prefix=" << x->prefix          << "\n"
+       << "job_label="  << x->prefix_label    << "\n"
+       << "job_quota="  << x->quota           << "\n"
+       << "job_hash="   << std::atomic_load(&x->live_index)->source_hash << "\n";
+    boost::lock_guard<boost::mutex> lock(my_output_lock);
+    for (const auto & hits : x->word_hit_counts) ss << "hit=" << hits.first << " " << hits.second << "\n";
+    for (const auto & found : x->found_words)
+    {
+      for (const std::string & address : found.second) ss << "found=" << found.first << " " << address << "\n";
+    }
+  }
+
+  //Owner only, as a walk's base key is in it.  A temporary file left by a
+  //crash is removed so that it isn't reused with its old permissions.
+  std::string temp_filename = filename + ".tmp";
+  std::remove(temp_filename.c_str());
+  batched_output out;
+  if (!out.open(temp_filename, true, S_IRUSR | S_IWUSR))
+  {
+    fail_msg_writer() << "\rcould not open " << temp_filename << " for writing" << std::endl;
+    return false;
+  }
+  out.add(ss.str(), true);
+  bool ok = out.flush(true);
+  out.close();
+  if (!ok || std::rename(temp_filename.c_str(), filename.c_str()) != 0)
+  {
+    fail_msg_writer() << "\rcould not write checkpoint " << filename << std::endl;
+    std::remove(temp_filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+void finish_search()
+{
+  std::cout << "Stopping Vanity Search..." << std::endl;
+  job_stop_time=Clock::now();
+  search_active=false;
+  search_paused=false;
+  park_workers();
+  stop_stats();
+  stop_writer();
+  if (reload_thread.joinable()) reload_thread.join();
+  print_thread_stats();
+  if (key_batches.active()) std::cout << format_walk_progress() << std::endl;
+
+  boost::lock_guard<boost::mutex> lock(checkpoint_lock);
+  for (const auto & x : *std::atomic_load(&live_jobs)) x->output.close(current_durability.fsync || !checkpoint_filename.empty());
+  if (!checkpoint_filename.empty() && write_checkpoint(checkpoint_filename))
+  {
+    std::cout << "Checkpoint written to " << checkpoint_filename << std::endl;
+  }
+  std::cout << "Vanity Search Stopped" << std::endl;
+}
+
+//--------------------------------------------------------------------------------
+
+//Called by the stats thread.  Gives way if a command is already stopping the
+//search, since that command will be waiting for this thread to finish.
+void stop_at_limit(const std::string& reason)
+{
+  boost::unique_lock<boost::mutex> control_lock(search_control_lock, boost::defer_lock);
+  while (!control_lock.try_lock())
+  {
+    if (!stats_running) return;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  if (!search_active || !stats_running) return;
+
+  std::cout << "\rJob limit reached: " << reason << std::endl;
+  thread_safe_print(format_stats());
+  finish_search();
+  m_cmd_binder.print_prompt();
+}
+
+//--------------------------------------------------------------------------------
+
+bool stop_search(const std::vector<std::string> &args)
+{
+  boost::lock_guard<boost::mutex> control_lock(search_control_lock);
+  if (!search_active)
+  {
+    std::cout << "Search is not active.  No action taken." << std::endl;
+    return true;
+  }
+  finish_search();
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//Parks the workers at their next batch boundary.  Keys, counters and the
+//output file are kept as they are.
+bool pause_search(const std::vector<std::string> &args)
+{
+  boost::lock_guard<boost::mutex> control_lock(search_control_lock);
+  if (!search_active || search_paused)
+  {
+    std::cout << "Search is not running.  No action taken." << std::endl;
+    return true;
+  }
+  park_workers();
+  search_paused=true;
+  std::cout << "Vanity Search Paused" << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//A job as saved in a checkpoint
+struct checkpoint_job
+{
+  std::string name;
+  std::string word_source;
+  std::string output_filename;
+  uint64_t    prefix {0};
+  std::string prefix_label;
+  uint32_t    quota  {0};
+  uint64_t    source_hash {0};
+  std::unordered_map<std::string, uint64_t>                 hit_counts;
+  std::unordered_map<std::string, std::vector<std::string>> found_words;
+};
+
+//Reads a checkpoint written by write_checkpoint.  Repeated keys fill in the
+//walk ranges and the jobs, the rest are left in values.
+bool read_checkpoint(const std::string& filename, std::map<std::string, std::string>& values,
+                     walk_snapshot& walk, std::vector<checkpoint_job>& jobs)
+{
+  std::ifstream checkpoint_file(filename);
+  if (!checkpoint_file.is_open())
+  {
+    fail_msg_writer() << "could not open " << filename << std::endl;
+    return false;
+  }
+
+  std::string line;
+  try
+  {
+    while (getline(checkpoint_file, line))
+    {
+      size_t equals = line.find('=');
+      if (equals == std::string::npos) continue;
+      std::string key   = line.substr(0, equals);
+      std::string value = line.substr(equals + 1);
+      size_t      space = value.find(' ');
+
+      if (key == "walk_range" && space != std::string::npos)
+      {
+        walk.ranges.push_back(std::make_pair(boost::lexical_cast<uint64_t>(value.substr(0, space)),
+                                             boost::lexical_cast<uint64_t>(value.substr(space + 1))));
+      }
+      else if (key == "job")
+      {
+        jobs.push_back(checkpoint_job());
+        jobs.back().name = value;
+      }
+      else if (key.compare(0, 4, "job_") == 0 || key == "hit" || key == "found")
+      {
+        if (jobs.empty()) throw boost::bad_lexical_cast();
+        checkpoint_job & job = jobs.back();
+        if      (key == "job_words")  job.word_source     = value;
+        else if (key == "job_output") job.output_filename = value;
+        else if (key == "job_label")  job.prefix_label    = value;
+        else if (key == "job_prefix") job.prefix          = boost::lexical_cast<uint64_t>(value);
+        else if (key == "job_quota")  job.quota           = boost::lexical_cast<uint32_t>(value);
+        else if (key == "job_hash")   job.source_hash     = boost::lexical_cast<uint64_t>(value);
+        else if (key == "hit")
+        {
+          size_t last_space = value.rfind(' ');
+          if (last_space == std::string::npos) throw boost::bad_lexical_cast();
+          job.hit_counts[value.substr(0, last_space)] = boost::lexical_cast<uint64_t>(value.substr(last_space + 1));
+        }
+        else if (key == "found" && space != std::string::npos)
+        {
+          job.found_words[value.substr(0, space)].push_back(value.substr(space + 1));
+        }
+      }
+      else
+      {
+        values[key] = value;
+      }
+    }
+  }
+  catch(boost::bad_lexical_cast& e)
+  {
+    fail_msg_writer() << "could not parse " << filename << " at \"" << line << "\"" << std::endl;
+    return false;
+  }
+  if (values["vanity_checkpoint"] != "1" || jobs.empty())
+  {
+    fail_msg_writer() << filename << " is not a vanity search checkpoint" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//The options a checkpoint records, set together when it is resumed
+struct checkpoint_settings
+{
+  uint32_t           min_start_pos;
+  uint32_t           max_start_pos;
+  uint32_t           search_word_length;
+  uint32_t           batch_size;
+  output_format      format;
+  bool               walk;
+  bool               walk_random_base;
+  crypto::secret_key walk_base;
+  uint64_t           walk_keys;
+  job_limits         limits;
+};
+
+checkpoint_settings current_checkpoint_settings()
+{
+  return checkpoint_settings {options::min_start_pos, options::max_start_pos, options::search_word_length, options::batch_size,
+                              options::format, options::walk, options::walk_random_base, options::walk_base, options::walk_keys,
+                              options::limits};
+}
+
+void apply_checkpoint_settings(const checkpoint_settings& x)
+{
+  options::min_start_pos      = x.min_start_pos;
+  options::max_start_pos      = x.max_start_pos;
+  options::search_word_length = x.search_word_length;
+  options::batch_size         = x.batch_size;
+  options::format             = x.format;
+  options::walk               = x.walk;
+  options::walk_random_base   = x.walk_random_base;
+  options::walk_base          = x.walk_base;
+  options::walk_keys          = x.walk_keys;
+  options::limits             = x.limits;
+}
+
+//--------------------------------------------------------------------------------
+
+//Starts a new search carrying on from a checkpoint: same settings, jobs, hit
+//counts and counters, and for a key-space walk only the batches not walked
+//yet.  The jobs replace any defined now and append to their outputs.  The
+//settings are all checked before any option changes, and put back, with the
+//jobs left as they were, if the jobs can't be loaded or their outputs opened.
+void resume_from_checkpoint(const std::string& filename, const std::vector<std::string>& args)
+{
+  std::map<std::string, std::string> values;
+  std::vector<checkpoint_job>        saved_jobs;
+  search_checkpoint                  checkpoint;
+  checkpoint.walk_state = walk_snapshot {0, 0, {}};
+  if (!read_checkpoint(filename, values, checkpoint.walk_state, saved_jobs)) return;
+
+  if (options::retention != retention_mode::all)
+  {
+    fail_msg_writer() << "checkpoints need retention all, set it before resuming" << std::endl;
+    return;
+  }
+
+  checkpoint_settings settings = current_checkpoint_settings();
+  uint64_t walk_batches = 0;
+  try
+  {
+    checkpoint.num_threads      = boost::lexical_cast<uint32_t>(values["threads"]);
+    checkpoint.addresses        = boost::lexical_cast<uint64_t>(values["addresses"]);
+    checkpoint.seconds          = boost::lexical_cast<double>(values["seconds"]);
+    checkpoint.matches          = boost::lexical_cast<uint64_t>(values["matches"]);
+    checkpoint.walk             = (values["walk"] == "1");
+    settings.min_start_pos      = boost::lexical_cast<uint32_t>(values["min_start_pos"]);
+    settings.max_start_pos      = boost::lexical_cast<uint32_t>(values["max_start_pos"]);
+    settings.search_word_length = boost::lexical_cast<uint32_t>(values["search_word_length"]);
+    settings.batch_size         = boost::lexical_cast<uint32_t>(values["batch_size"]);
+    settings.walk               = checkpoint.walk;
+    if (checkpoint.walk)
+    {
+      walk_batches                     = boost::lexical_cast<uint64_t>(values["walk_batches"]);
+      checkpoint.walk_state.next_batch = boost::lexical_cast<uint64_t>(values["walk_next"]);
+      checkpoint.walk_state.done       = boost::lexical_cast<uint64_t>(values["walk_done"]);
+      if (!epee::string_tools::hex_to_pod(values["walk_base"], settings.walk_base)) throw boost::bad_lexical_cast();
+      settings.walk_random_base = false;
+    }
+    //Checkpoints from before the limits were saved keep the current ones
+    if (values.count("limit_matches"))
+    {
+      settings.limits.matches      = boost::lexical_cast<uint64_t>(values["limit_matches"]);
+      settings.limits.all_words    = (values["limit_all_words"] == "1");
+      settings.limits.wall_seconds = boost::lexical_cast<uint32_t>(values["limit_time"]);
+      settings.limits.cpu_seconds  = boost::lexical_cast<uint32_t>(values["limit_cpu"]);
+    }
+    if (!parse_output_format(values["format"], settings.format) || settings.batch_size == 0) throw boost::bad_lexical_cast();
+  }
+  catch(boost::bad_lexical_cast& e)
+  {
+    fail_msg_writer() << "could not parse the settings in " << filename << std::endl;
+    return;
+  }
+  std::string reason;
+  if (!check_search_params(settings.min_start_pos, settings.max_start_pos, settings.search_word_length, options::address_prefix, reason))
+  {
+    fail_msg_writer() << "invalid search parameters in " << filename << ", " << reason << std::endl;
+    return;
+  }
+  if (checkpoint.walk)
+  {
+    if (walk_batches > UINT64_MAX / settings.batch_size)
+    {
+      fail_msg_writer() << "the key space walk in " << filename << " is too large" << std::endl;
+      return;
+    }
+    settings.walk_keys = walk_batches * settings.batch_size;
+  }
+
+  uint32_t num_threads = checkpoint.num_threads;
+  if (args.size() > 1)
+  {
+    try
+    {
+      num_threads = boost::lexical_cast<uint32_t>(args[1]);
+    }
+    catch(boost::bad_lexical_cast& e)
+    {
+      fail_msg_writer() << "could not parse number of threads" << std::endl;
+      return;
+    }
+  }
+  if (num_threads == 0 || num_threads > MAX_SEARCH_THREADS)
+  {
+    fail_msg_writer() << "between 1 and " << MAX_SEARCH_THREADS << " threads are supported" << std::endl;
+    return;
+  }
+
+  //The jobs' indexes are built with the checkpoint's settings
+  checkpoint_settings previous = current_checkpoint_settings();
+  apply_checkpoint_settings(settings);
+
+  //The hit counts go in first so that words at their quota stay retired
+  auto jobs = std::make_shared<job_list>();
+  for (const checkpoint_job & x : saved_jobs)
+  {
+    auto job = make_job(x.name, x.word_source, x.output_filename, x.prefix, x.prefix_label, x.quota);
+    job->word_hit_counts = x.hit_counts;
+    job->found_words     = x.found_words;
+    if (!load_job_words(*job))
+    {
+      fail_msg_writer() << "could not load the words of job " << x.name << ", not resuming" << std::endl;
+      apply_checkpoint_settings(previous);
+      return;
+    }
+    if (std::atomic_load(&job->live_index)->source_hash != x.source_hash)
+    {
+      fail_msg_writer() << x.word_source << " has changed since the checkpoint, not resuming" << std::endl;
+      apply_checkpoint_settings(previous);
+      return;
+    }
+    jobs->push_back(job);
+  }
+
+  //The live jobs are only replaced once every output is open
+  try
+  {
+    for (const auto & x : *jobs)
+    {
+      if (!open_job_output(*x, false))
+      {
+        apply_checkpoint_settings(previous);
+        return;
+      }
+    }
+  }
+  catch (std::exception &e)
+  {
+    fail_msg_writer() << "exception while opening files: " << e.what() << std::endl;
+    apply_checkpoint_settings(previous);
+    return;
+  }
+  for (const auto & x : *std::atomic_load(&live_jobs)) stop_word_stream(*x);
+  publish_jobs(jobs);
+  launch_search(num_threads, placement_policy::none, std::vector<uint32_t>(), &checkpoint);
+}
+
+//--------------------------------------------------------------------------------
+
+//resume continues a paused search, resume <checkpoint> a stopped one
+bool resume_search(const std::vector<std::string> &args)
+{
+  boost::lock_guard<boost::mutex> control_lock(search_control_lock);
+  if (!args.empty())
+  {
+    if (search_active) std::cout << "Search is already active.  No action taken." << std::endl;
+    else resume_from_checkpoint(args[0], args);
+    return true;
+  }
+  if (!search_paused)
+  {
+    std::cout << "Search is not paused.  No action taken." << std::endl;
+    return true;
+  }
+  search_paused=false;
+  resume_workers();
+  std::cout << "Vanity Search Resumed" << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//Addresses per second of the whole pool over one timed run
+double run_trial(uint32_t num_threads, uint32_t batch_size, uint32_t seconds)
+{
+  uint32_t saved_batch_size = options::batch_size;
+  options::batch_size = batch_size;
+  auto start_time = Clock::now();
+  run_workers(num_threads, placement_policy::none, std::vector<uint32_t>(), true);
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  park_workers();
+  auto end_time = Clock::now();
+  options::batch_size = saved_batch_size;
+
+  double duration = ((double) std::chrono::duration_cast<std::chrono::milliseconds>(end_time-start_time).count())/1000;
+  return (double) job_addresses_checked / duration;
+}
+
+//--------------------------------------------------------------------------------
+
+bool save_autotune(uint32_t num_threads, uint32_t batch_size, double addresses_per_sec)
+{
+  std::ofstream autotune_file(AUTOTUNE_FILENAME);
+  if (!autotune_file.is_open()) return false;
+  autotune_file << "cpus="              << host_cpu_limits.effective << std::endl
+                << "threads="           << num_threads       << std::endl
+                << "batch_size="        << batch_size        << std::endl
+                << "addresses_per_sec=" << addresses_per_sec << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//Settings from an earlier autotune, unless they were tuned with a different
+//number of usable CPUs
+void load_autotune()
+{
+  std::ifstream autotune_file(AUTOTUNE_FILENAME);
+  if (!autotune_file.is_open()) return;
+
+  std::map<std::string, std::string> values;
+  std::string line;
+  while (getline(autotune_file, line))
+  {
+    size_t equals = line.find('=');
+    if (equals != std::string::npos) values[line.substr(0, equals)] = line.substr(equals + 1);
+  }
+
+  try
+  {
+    if (boost::lexical_cast<uint32_t>(values["cpus"]) != host_cpu_limits.effective)
+    {
+      std::cout << AUTOTUNE_FILENAME << " was tuned with a different number of CPUs, ignoring it" << std::endl;
+      return;
+    }
+    uint32_t num_threads = boost::lexical_cast<uint32_t>(values["threads"]);
+    uint32_t batch_size  = boost::lexical_cast<uint32_t>(values["batch_size"]);
+    if (num_threads == 0 || batch_size == 0) return;
+    if (num_threads > MAX_SEARCH_THREADS)
+    {
+      fail_msg_writer() << AUTOTUNE_FILENAME << " asks for " << num_threads << " threads, at most " << MAX_SEARCH_THREADS
+                        << " are supported, ignoring it" << std::endl;
+      return;
+    }
+    options::num_threads = num_threads;
+    options::batch_size  = batch_size;
+    std::cout << "Using autotuned settings: " << num_threads << " threads, batch size " << batch_size << std::endl;
+  }
+  catch(boost::bad_lexical_cast& e)
+  {
+    fail_msg_writer() << "could not parse " << AUTOTUNE_FILENAME << std::endl;
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+//Size the default pool to the CPUs the process can actually use, which in a
+//container may be far fewer than the host has
+void init_default_threads()
+{
+  host_cpu_limits      = read_cpu_limits();
+  options::num_threads = std::min<uint32_t>(host_cpu_limits.effective, MAX_SEARCH_THREADS);
+
+  std::stringstream ss;
+  ss << "CPUs: " << host_cpu_limits.online << " online";
+  if (host_cpu_limits.affinity != 0 && host_cpu_limits.affinity < host_cpu_limits.online) ss << ", " << host_cpu_limits.affinity << " in affinity mask";
+  if (host_cpu_limits.cpuset   != 0 && host_cpu_limits.cpuset   < host_cpu_limits.online) ss << ", " << host_cpu_limits.cpuset << " in cgroup cpuset";
+  if (host_cpu_limits.quota    >  0) ss << ", cgroup quota of " << host_cpu_limits.quota << " CPUs";
+  ss << ".  Default number of threads: " << options::num_threads;
+  std::cout << ss.str() << std::endl;
+}
+
+//--------------------------------------------------------------------------------
+
+bool autotune(const std::vector<std::string> &args)
+{
+  boost::lock_guard<boost::mutex> control_lock(search_control_lock);
+  uint32_t trial_seconds = DEFAULT_TRIAL_SECONDS;
+
+  if (search_active)
+  {
+    std::cout << "Search is active.  Stop it before running autotune." << std::endl;
+    return true;
+  }
+  if (args.empty())
+  {
+    fail_msg_writer() << "Need <word file> or <word> argument" << std::endl;
+    return true;
+  }
+  if (is_word_stream(args[0]))
+  {
+    fail_msg_writer() << "autotune takes a word file or a word, a stream would be used up by the trials" << std::endl;
+    return true;
+  }
+  if (args.size() > 1)
+  {
+    try
+    {
+      trial_seconds = boost::lexical_cast<uint32_t>(args[1]);
+      if (trial_seconds == 0) throw boost::bad_lexical_cast();
+    }
+    catch(boost::bad_lexical_cast& e)
+    {
+      fail_msg_writer() << "Expected a positive number of seconds per trial" << std::endl;
+      return true;
+    }
+  }
+
+  //Trials run on this word list alone, the jobs are put back afterwards
+  std::shared_ptr<const job_list> saved_jobs = std::atomic_load(&live_jobs);
+  auto trial_job = make_job("autotune", args[0], "", options::address_prefix, options::address_prefix_label, options::word_quota);
+  if (!load_job_words(*trial_job))
+  {
+    fail_msg_writer() << "could not load the words for the trials" << std::endl;
+    return true;
+  }
+  publish_jobs(std::make_shared<job_list>(1, trial_job));
+
+  //Powers of two, plus the number of physical cores and of hardware threads
+  std::set<uint32_t> thread_counts;
+  uint32_t hardware_threads = std::min<uint32_t>(host_cpu_limits.effective, MAX_SEARCH_THREADS);
+  for (uint32_t i=1; i<hardware_threads; i*=2) thread_counts.insert(i);
+  thread_counts.insert(hardware_threads);
+  uint32_t physical_cores = 0;
+  for (const cpu_info & x : read_cpu_topology()) physical_cores += (x.smt_index == 0);
+  if (physical_cores != 0 && physical_cores <= MAX_SEARCH_THREADS) thread_counts.insert(physical_cores);
+
+  std::cout << "Autotuning with " << trial_seconds << " second trials..." << std::endl;
+  uint32_t best_threads = options::num_threads;
+  uint32_t best_batch   = options::batch_size;
+  double   best_rate    = 0;
+  for (uint32_t num_threads : thread_counts)
+  {
+    double rate = run_trial(num_threads, best_batch, trial_seconds);
+    std::cout << "  threads " << num_threads << ", batch size " << best_batch << ": " << rate << " Addresses / Sec" << std::endl;
+    if (rate > best_rate)
+    {
+      best_rate    = rate;
+      best_threads = num_threads;
+    }
+  }
+  for (uint32_t batch_size : {16u, 64u, 256u, 1024u})
+  {
+    if (batch_size == best_batch) continue;
+    double rate = run_trial(best_threads, batch_size, trial_seconds);
+    std::cout << "  threads " << best_threads << ", batch size " << batch_size << ": " << rate << " Addresses / Sec" << std::endl;
+    if (rate > best_rate)
+    {
+      best_rate  = rate;
+      best_batch = batch_size;
+    }
+  }
+
+  publish_jobs(saved_jobs);
+
+  options::num_threads = best_threads;
+  options::batch_size  = best_batch;
+  success_msg_writer() << "Best: " << best_threads << " threads, batch size " << best_batch << ", " << best_rate << " Addresses / Sec" << std::endl;
+  if (!save_autotune(best_threads, best_batch, best_rate))
+  {
+    fail_msg_writer() << "could not write " << AUTOTUNE_FILENAME << std::endl;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//reload <word file> [job]
+bool reload_words(const std::vector<std::string> &args)
+{
+  boost::lock_guard<boost::mutex> control_lock(search_control_lock);
+  if (args.empty())
+  {
+    fail_msg_writer() << "Need <word file> argument" << std::endl;
+    return true;
+  }
+  if (!search_active)
+  {
+    std::cout << "Search is not active.  Use start instead." << std::endl;
+    return true;
+  }
+  if (reload_running)
+  {
+    std::cout << "A reload is already in progress.  No action taken." << std::endl;
+    return true;
+  }
+  if (is_word_stream(args[0]))
+  {
+    fail_msg_writer() << "reload takes a word file, add a job to search a stream" << std::endl;
+    return true;
+  }
+
+  //Without a job name: the only job, or else the default one
+  std::shared_ptr<const job_list> jobs = std::atomic_load(&live_jobs);
+  std::shared_ptr<search_job> job;
+  if (args.size() > 1)    job = find_job(args[1]);
+  else if (jobs->size() == 1) job = jobs->front();
+  else                    job = find_job(DEFAULT_JOB_NAME);
+  if (!job)
+  {
+    fail_msg_writer() << (args.size() > 1 ? "No job named " + args[1] : std::string("Several jobs are running, name the one to reload")) << std::endl;
+    return true;
+  }
+
+  if (reload_thread.joinable()) reload_thread.join();
+  stop_word_stream(*job);
+  reload_running = true;
+  reload_thread  = std::thread(reload_word_list, job, args[0]);
+  std::cout << "Reloading word list of job " << job->name << " from " << args[0] << " in the background..." << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+bool set_threads(const std::vector<std::string> &args)
+{
+  boost::lock_guard<boost::mutex> control_lock(search_control_lock);
+  if (!search_active)
+  {
+    std::cout << "Search is not active.  Give the number of threads to start instead." << std::endl;
+    return true;
+  }
+
+  int num_threads;
+  try
+  {
+    num_threads = args.empty() ? -1 : boost::lexical_cast<int>(args[0]);
+  }
+  catch(boost::bad_lexical_cast& e)
+  {
+    num_threads = -1;
+  }
+  if (num_threads < 1)
+  {
+    fail_msg_writer() << "Expected a positive number of threads" << std::endl;
+    return true;
+  }
+  if (num_threads > MAX_SEARCH_THREADS)
+  {
+    fail_msg_writer() << "At most " << MAX_SEARCH_THREADS << " threads are supported" << std::endl;
+    return true;
+  }
+
+  if ((uint32_t) num_threads > host_cpu_limits.effective)
+  {
+    std::cout << "Warning: " << num_threads << " threads requested but only " << host_cpu_limits.effective
+              << " CPUs are available to this process" << std::endl;
+  }
+  resize_workers(num_threads);
+  success_msg_writer() << "Search now uses " << num_threads << " threads" << (search_paused ? " once resumed" : "") << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//job add <name> <word file or word> <output file> [prefix] [quota]
+//job remove <name>
+//job list
+bool manage_jobs(const std::vector<std::string> &args)
+{
+  boost::lock_guard<boost::mutex> control_lock(search_control_lock);
+  std::shared_ptr<const job_list> jobs = std::atomic_load(&live_jobs);
+  std::string command = args.empty() ? "list" : boost::to_lower_copy(args[0]);
+
+  if (command == "list")
+  {
+    if (jobs->empty())
+    {
+      std::cout << "No jobs" << std::endl;
+      return true;
+    }
+    boost::lock_guard<boost::mutex> lock(my_output_lock);
+    for (const auto & x : *jobs)
+    {
+      std::shared_ptr<const word_index> index = std::atomic_load(&x->live_index);
+      std::cout << x->name << ": " << (index ? index->word_count : 0) << " words from " << x->word_source
+                << ", " << x->prefix_label << " prefix, quota " << x->quota << ", output " << x->output_filename
+                << (search_active ? ", " + std::to_string(x->matches_this_search) + " matches" : std::string()) << std::endl;
+    }
+    return true;
+  }
+
+  if (command == "add")
+  {
+    if (args.size() < 4)
+    {
+      fail_msg_writer() << "Need job add <name> <word file or word> <output file> [prefix] [quota]" << std::endl;
+      return true;
+    }
+    if (find_job(args[1]))
+    {
+      fail_msg_writer() << "There is already a job named " << args[1] << std::endl;
+      return true;
+    }
+
+    uint64_t    prefix = options::address_prefix;
+    std::string label  = options::address_prefix_label;
+    uint32_t    quota  = options::word_quota;
+    if (args.size() > 4 && !parse_prefix(args[4], prefix, label))
+    {
+      fail_msg_writer() << "Invalid prefix choice" << std::endl;
+      return true;
+    }
+    try
+    {
+      if (args.size() > 5) quota = boost::lexical_cast<uint32_t>(args[5]);
+    }
+    catch(boost::bad_lexical_cast& e)
+    {
+      fail_msg_writer() << "Expected a non-negative integer for the quota" << std::endl;
+      return true;
+    }
+
+    auto job = make_job(args[1], args[2], args[3], prefix, label, quota);
+    if (!load_job_words(*job)) return true;
+    if (!open_job_output(*job, true)) return true;
+
+    auto new_jobs = std::make_shared<job_list>(*jobs);
+    new_jobs->push_back(job);
+    publish_jobs(new_jobs);
+    success_msg_writer() << "Job " << job->name << " added with " << std::atomic_load(&job->live_index)->word_count << " words"
+                         << (search_active ? ", searching now" : "") << std::endl;
+    return true;
+  }
+
+  if (command == "remove")
+  {
+    if (args.size() < 2)
+    {
+      fail_msg_writer() << "Need job remove <name>" << std::endl;
+      return true;
+    }
+    auto new_jobs = std::make_shared<job_list>();
+    std::shared_ptr<search_job> removed;
+    for (const auto & x : *jobs)
+    {
+      if (x->name != args[1]) new_jobs->push_back(x);
+      else                    removed = x;
+    }
+    if (new_jobs->size() == jobs->size())
+    {
+      fail_msg_writer() << "No job named " << args[1] << std::endl;
+      return true;
+    }
+    if (search_active && new_jobs->empty())
+    {
+      fail_msg_writer() << "Cannot remove the last job of a running search, stop it instead" << std::endl;
+      return true;
+    }
+    //Matches already queued for it are still written, its output is closed
+    //once the last of them is
+    publish_jobs(new_jobs);
+    stop_word_stream(*removed);
+    success_msg_writer() << "Job " << args[1] << " removed" << std::endl;
+    return true;
+  }
+
+  fail_msg_writer() << "Expected job add, job remove or job list" << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+bool show_results(const std::vector<std::string> &args)
+{
+  int  length_threshold = 0;
+  char first_letter_filter;
+  bool filter_by_length=false;
+  bool filter_by_letter=false;
+  //If arguments are supplied in the form of single letters, only show results beginning with that letter.
+
+  if (args.size() == 1)
+  {
+    try
+    {
+      length_threshold = boost::lexical_cast<int>(args[0]);
+      filter_by_length = true;
+      std::cout << "Showing all words with length >= "
+                << length_threshold << std::endl
+                << "------------------------" << std::endl;
+    }
+    catch(boost::bad_lexical_cast& e)
+    {
+      if (args[0].length() > 1)
+      {
+        fail_msg_writer() << "Expected single letter or number or both" << std::endl;
+        return true;
+      }
+      else
+      {
+        first_letter_filter = args[0][0];
+        filter_by_letter = true;
+        std::cout << "Showing all words starting with \""
+                  << first_letter_filter << "\"" << std::endl
+                  << "------------------------" << std::endl;
+      }
+    }
+  }
+  else if (!args.empty())
+  {
+    filter_by_letter = true;
+    filter_by_length = true;
+    try{
+      length_threshold    = boost::lexical_cast<int>(args[0]);
+      if (args[1].length() == 1)
+        first_letter_filter = args[1][0];
+      else
+      {
+        fail_msg_writer() << "Expected a number and a single letter in either order" << std::endl;
+        return true;
+      }
+    }
+    catch(boost::bad_lexical_cast& e){
+      try{
+        length_threshold    = boost::lexical_cast<int>(args[1]);
+        if (args[0].length() == 1)
+          first_letter_filter = args[0][0];
+        else
+        {
+          fail_msg_writer() << "Expected a number and a single letter in either order" << std::endl;
+          return true;
+        }
+      }
+      catch(boost::bad_lexical_cast& e){
+        fail_msg_writer() << "Expected a number and a single letter in either order" << std::endl;
+        return true;
+      }
+    }
+    std::cout << "Showing all words starting with \"" << first_letter_filter
+              << "\" with length >= " << length_threshold << std::endl
+              << "------------------------" << std::endl;
+  }
+  else
+  {
+    std::cout << "Showing all found words:" << std::endl
+              << "------------------------" << std::endl;
+  }
+
+  std::set<std::string> found_words_set;
+  {
+    boost::lock_guard<boost::mutex> lock(my_output_lock);
+    for (const auto & job : *std::atomic_load(&live_jobs))
+    {
+      for (const auto & x : job->found_words)
+      {
+        if ((filter_by_letter && x.first[0] != toupper(first_letter_filter))
+            || (filter_by_length && x.first.length() < length_threshold)) continue;
+
+        found_words_set.insert(x.first);
+      }
+    }
+  }
+  std::vector<std::string> found_words_vec(found_words_set.begin(), found_words_set.end());
+  int line_width = 0;
+  for (const std::string & x : found_words_vec)
+  {
+    std::cout << x << " ";
+    line_width += x.length()+1;
+    if (line_width > LINE_WIDTH_LIMIT)
+    {
+      std::cout << std::endl;
+      line_width = 0;
+    }
+  }
+  if (line_width != 0) std::cout << std::endl;
+  std::cout << "------------------------" << std::endl;
+
+  return true;
+}
+
+//-------------------------------------------------------------------------------
+
+bool show_addresses(const std::vector<std::string> &args)
+{
+  if (args.empty())
+  {
+    fail_msg_writer() << "Expected search word" << std::endl;
+    return true;
+  }
+
+  std::cout << "Showing results for \"" << args[0] << "\"" << "\n"
+            << "-------------------------" << std::endl;
+  std::shared_ptr<const job_list> jobs = std::atomic_load(&live_jobs);
+  bool found = false;
+  {
+    boost::lock_guard<boost::mutex> lock(my_output_lock);
+    for (const auto & job : *jobs)
+    {
+      auto search_results = job->found_words.find(boost::to_upper_copy(args[0]));
+      if (search_results == job->found_words.end()) continue;
+
+      found = true;
+      for (const std::string & x : search_results->second)
+      {
+        if (jobs->size() > 1) std::cout << job->name << ": ";
+        std::cout << x << std::endl;
+      }
+    }
+  }
+  if (!found) std::cout << "NONE FOUND" << std::endl;
+  std::cout << "------------------------" << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+bool set_prefix(const std::vector<std::string> &args)
+{
+  if (args.empty())
+  {
+    std::stringstream ss;
+
+    ss << "0x" << std::uppercase << std::setfill('0') << std::setw(4) << std::hex << options::address_prefix;
+    std::cout << "Current Coin         = " << options::address_prefix_label << "\n"
+              << "Current Prefix       = " << options::address_prefix << "\n"
+              << "Current Prefix (hex) = " << ss.str() << std::endl;
+    return true;
+  }
+
+  if (!parse_prefix(args[0], options::address_prefix, options::address_prefix_label))
+  {
+    fail_msg_writer() << "Invalid prefix choice" << std::endl;
+    return true;
+  }
+
+  success_msg_writer() << "Prefix successfully updated" << (search_active ? ", takes effect on the next start" : "") << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+bool set_params(const std::vector<std::string> &args)
+{
+  if(args.empty())
+  {
+    std::cout << "     Min Start Pos: " << options::min_start_pos << "\n"
+              << "     Max Start Pos: " << options::max_start_pos << "\n"
+              << "Search Word Length: " << options::search_word_length << std::endl;
+    return true;
+  }
+  else if (args.size() < 3)
+  {
+    fail_msg_writer() << "Expected four parameter values, see 'help' command." << std::endl;
+    return true;
+  }
+
+  uint32_t min_start_pos, max_start_pos, search_word_length;
+  try
+  {
+    min_start_pos      = boost::lexical_cast<uint32_t>(args[0]);
+    max_start_pos      = boost::lexical_cast<uint32_t>(args[1]);
+    search_word_length = boost::lexical_cast<uint32_t>(args[2]);
+  }
+  catch(boost::bad_lexical_cast& e)
+  {
+    fail_msg_writer() << "Expected three non-negative integers" << std::endl;
+    return true;
+  }
+
+  std::string reason;
+  if (!check_search_params(min_start_pos, max_start_pos, search_word_length, options::address_prefix, reason))
+  {
+    fail_msg_writer() << "Invalid parameters, " << reason << std::endl;
+    return true;
+  }
+  options::min_start_pos      = min_start_pos;
+  options::max_start_pos      = max_start_pos;
+  options::search_word_length = search_word_length;
+  success_msg_writer() << "Search parameters changed" << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+bool set_quota(const std::vector<std::string> &args)
+{
+  if (args.empty())
+  {
+    std::cout << "Word Quota: " << options::word_quota << (options::word_quota == 0 ? " (unlimited)" : "") << std::endl;
+    return true;
+  }
+
+  try
+  {
+    options::word_quota = boost::lexical_cast<uint32_t>(args[0]);
+    success_msg_writer() << "Word quota changed, takes effect on the next start" << std::endl;
+  }
+  catch(boost::bad_lexical_cast& e)
+  {
+    fail_msg_writer() << "Expected a non-negative integer" << std::endl;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//limit [off | matches <n> | all_words | time <seconds> | cpu <seconds>]...
+bool set_limits(const std::vector<std::string> &args)
+{
+  if (args.empty())
+  {
+    const job_limits & x = options::limits;
+    std::stringstream ss;
+    if (x.matches != 0)      ss << " after " << x.matches << " matches,";
+    if (x.all_words)         ss << " once every word is found,";
+    if (x.wall_seconds != 0) ss << " after " << x.wall_seconds << " seconds,";
+    if (x.cpu_seconds != 0)  ss << " after " << x.cpu_seconds << " CPU seconds,";
+    std::string limits = ss.str();
+    if (limits.empty()) std::cout << "No job limits, searches run until stopped" << std::endl;
+    else std::cout << "Searches stop" << limits.substr(0, limits.size() - 1) << std::endl;
+    return true;
+  }
+
+  job_limits limits = options::limits;
+  try
+  {
+    for (size_t i=0; i<args.size(); i++)
+    {
+      std::string name = boost::to_lower_copy(args[i]);
+      if (name == "off")
+      {
+        limits = job_limits {0, false, 0, 0};
+      }
+      else if (name == "all_words")
+      {
+        limits.all_words = true;
+      }
+      else if (i + 1 < args.size() && name == "matches")
+      {
+        limits.matches = boost::lexical_cast<uint64_t>(args[++i]);
+      }
+      else if (i + 1 < args.size() && name == "time")
+      {
+        limits.wall_seconds = boost::lexical_cast<uint32_t>(args[++i]);
+      }
+      else if (i + 1 < args.size() && name == "cpu")
+      {
+        limits.cpu_seconds = boost::lexical_cast<uint32_t>(args[++i]);
+      }
+      else
+      {
+        throw boost::bad_lexical_cast();
+      }
+    }
+  }
+  catch(boost::bad_lexical_cast& e)
+  {
+    fail_msg_writer() << "Expected off, matches <n>, all_words, time <seconds> or cpu <seconds>" << std::endl;
+    return true;
+  }
+  options::limits = limits;
+  success_msg_writer() << "Job limits changed, take effect on the next start" << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//index_cache [off | <directory>]
+bool set_index_cache(const std::vector<std::string> &args)
+{
+  if (args.empty())
+  {
+    if (options::index_cache_dir.empty()) std::cout << "Index cache off, word files are parsed on every load" << std::endl;
+    else std::cout << "Compiled word indexes are cached in " << options::index_cache_dir << std::endl;
+    return true;
+  }
+  if (reload_running)
+  {
+    fail_msg_writer() << "a word list is being reloaded, try again once it is done" << std::endl;
+    return true;
+  }
+  options::index_cache_dir = (boost::to_lower_copy(args[0]) == "off") ? std::string() : args[0];
+  if (options::index_cache_dir.empty()) success_msg_writer() << "Index cache off" << std::endl;
+  else success_msg_writer() << "Caching compiled word indexes in " << options::index_cache_dir << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//set_format [text | jsonl | csv | binary]
+bool set_format(const std::vector<std::string> &args)
+{
+  if (args.empty())
+  {
+    std::cout << "Output format: " << output_format_name(options::format) << std::endl;
+    return true;
+  }
+  output_format format;
+  if (!parse_output_format(boost::to_lower_copy(args[0]), format))
+  {
+    fail_msg_writer() << "Expected text, jsonl, csv or binary" << std::endl;
+    return true;
+  }
+  options::format = format;
+  success_msg_writer() << "Output format " << output_format_name(format) << " for output files opened from now on" << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//Coin name of a prefix, as set_prefix takes it
+std::string prefix_label(uint64_t prefix)
+{
+  for (const auto & x : prefix_map)
+  {
+    if (x.second == prefix) return x.first;
+  }
+  return "NA";
+}
+
+//--------------------------------------------------------------------------------
+
+//Derives the address, view key and mnemonic of entries first to last-1 and
+//appends them to out.  Runs on its own thread with its own account.
+void expand_log_entries(const std::vector<match_log_entry>& entries, size_t first, size_t last, const std::vector<std::string>& words,
+                        output_format format, std::string& out)
+{
+  trim_account account;
+  for (size_t i=first; i<last; i++)
+  {
+    const match_log_entry & x = entries[i];
+    account.seek_spend_key(x.spend_key, 0);
+    account.derive_view_keys();
+
+    match_record record;
+    record.word         = words[x.word_id];
+    record.address      = account.get_public_address_str(x.prefix);
+    record.spend_key    = x.spend_key;
+    record.view_key     = account.get_raw_private_view_key();
+    record.start_pos    = x.start_pos;
+    record.case_quality = case_quality(record.address, x.start_pos, record.word.length());
+    record.quota        = 0;
+    record.thread_num   = x.thread_num;
+    record.found_ms     = x.found_ms;
+
+    std::string electrum_words;
+    if (x.prefix == ADDRESS_BASE58_PREFIX_AEON)
+    {
+      crypto::AeonWords::bytes_to_words(record.spend_key, electrum_words);
+    }
+    else
+    {
+      crypto::ElectrumWords::bytes_to_words(record.spend_key, electrum_words, "English");
+    }
+    append_match(out, format, record, prefix_label(x.prefix), electrum_words);
+  }
+}
+
+//--------------------------------------------------------------------------------
+
+//export <log file> <output file> [text | jsonl | csv] [threads]
+bool export_log(const std::vector<std::string> &args)
+{
+  if (args.size() < 2)
+  {
+    fail_msg_writer() << "Need export <binary log> <output file> [text | jsonl | csv] [threads]" << std::endl;
+    return true;
+  }
+
+  output_format format = output_format::text;
+  uint32_t num_threads = options::num_threads;
+  if (args.size() > 2 && (!parse_output_format(boost::to_lower_copy(args[2]), format) || format == output_format::binary))
+  {
+    fail_msg_writer() << "Expected text, jsonl or csv" << std::endl;
+    return true;
+  }
+  try
+  {
+    if (args.size() > 3) num_threads = boost::lexical_cast<uint32_t>(args[3]);
+  }
+  catch(boost::bad_lexical_cast& e)
+  {
+    num_threads = 0;
+  }
+  if (num_threads == 0 || num_threads > MAX_SEARCH_THREADS)
+  {
+    fail_msg_writer() << "Expected 1 to " << MAX_SEARCH_THREADS << " threads" << std::endl;
+    return true;
+  }
+
+  match_log_reader reader;
+  if (!reader.open(args[0]))
+  {
+    fail_msg_writer() << "could not read " << args[0] << " as a binary match log" << std::endl;
+    return true;
+  }
+  batched_output output;
+  if (!output.open(args[1], true))
+  {
+    fail_msg_writer() << "could not open " << args[1] << " for writing" << std::endl;
+    return true;
+  }
+
+  //A window at a time, so that memory use doesn't grow with the log
+  auto start_time = Clock::now();
+  uint64_t exported = 0;
+  std::string header;
+  append_header(header, format);
+  output.add(header, false);
+  std::vector<match_log_entry> entries;
+  std::vector<std::string>     texts(num_threads);
+  while (reader.read(entries, EXPORT_WINDOW_MATCHES))
+  {
+    std::vector<std::thread> threads;
+    for (uint32_t i=0; i<num_threads; i++)
+    {
+      texts[i].clear();
+      threads.push_back(std::thread(expand_log_entries, std::cref(entries), entries.size() * i / num_threads,
+                                    entries.size() * (i + 1) / num_threads, std::cref(reader.words()), format, std::ref(texts[i])));
+    }
+    for (std::thread & x : threads) x.join();
+    for (const std::string & x : texts) output.add(x, false);
+    if (!output.flush(false))
+    {
+      fail_msg_writer() << "could not write " << args[1] << std::endl;
+      return true;
+    }
+    exported += entries.size();
+  }
+  output.close();
+  if (!reader.error().empty())
   {
-    std::cout << "Search is already active.  No action taken." << std::endl;
+    fail_msg_writer() << args[0] << ": " << reader.error() << ", stopped after " << exported << " matches" << std::endl;
     return true;
   }
 
-  if (args.size() < 2)
+  double seconds = std::chrono::duration<double>(Clock::now() - start_time).count();
+  success_msg_writer() << "Exported " << exported << " matches to " << args[1] << " in " << seconds << " Seconds" << std::endl;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+
+//durability [default | records <n> | ms <t> | fsync on|off | sync_length <n>]...
+bool set_durability(const std::vector<std::string> &args)
+{
+  durability_policy x = options::durability;
+  if (args.empty())
   {
-    fail_msg_writer() << "Need <word file> or <word> and <output file> arguments" << std::endl;
+    std::stringstream ss;
+    ss << "Matches are written ";
+    if (x.flush_records == 0 && x.flush_ms == 0) ss << "each time the match queue is drained";
+    if (x.flush_records != 0) ss << "once " << x.flush_records << " are waiting";
+    if (x.flush_records != 0 && x.flush_ms != 0) ss << " or ";
+    if (x.flush_ms != 0) ss << "every " << x.flush_ms << " ms";
+    if (x.fsync) ss << ", with fsync";
+    if (x.sync_length != 0) ss << ".  Words of " << x.sync_length << " letters or more are synced straight away";
+    std::cout << ss.str() << std::endl;
     return true;
   }
-  else
+
+  try
   {
-    try
+    for (size_t i=0; i<args.size(); i++)
     {
-      bool success = load_word_list(args[0]);
-      if (!success)
+      std::string name = boost::to_lower_copy(args[i]);
+      if (name == "default")
       {
-        //fail_msg_writer() << "could not load word list file " << args[0] << std::endl;
-        //return true;
-        std::cout << "Using \"" << args[0] << "\" as a single search word..." << std::endl;
-        single_word_search = true;
-        search_word = args[0];
+        x = durability_policy {0, 0, false, 0};
       }
-
-      my_ostream.open(args[1]);
-      if (!my_ostream.is_open())
+      else if (i + 1 < args.size() && name == "records")
       {
-        fail_msg_writer() << "could not open " << args[1] << " for writing" << std::endl;
-        return true;
+        x.flush_records = boost::lexical_cast<uint32_t>(args[++i]);
       }
-    }
-    catch (std::exception &e)
-    {
-      fail_msg_writer() << "exception while opening files: " << e.what() << std::endl;
-      return true;
-    }
-    if (args.size() > 2)
-    {
-      try
+      else if (i + 1 < args.size() && name == "ms")
       {
-        search_num_threads = boost::lexical_cast<int>(args[2]);
+        x.flush_ms = boost::lexical_cast<uint32_t>(args[++i]);
       }
-      catch(boost::bad_lexical_cast& e)
+      else if (i + 1 < args.size() && name == "fsync")
       {
-        std::cout << "Could not parse number of threads" << std::endl
-                  << "Using default number of threads (" << DEFAULT_NUM_THREADS << ")" << std::endl;
-        search_num_threads = DEFAULT_NUM_THREADS;
+        std::string value = boost::to_lower_copy(args[++i]);
+        if (value != "on" && value != "off") throw boost::bad_lexical_cast();
+        x.fsync = (value == "on");
       }
-      if (search_num_threads < 0){
-        std::cout << "Positive number of threads required" << std::endl;
-        return true;
+      else if (i + 1 < args.size() && name == "sync_length")
+      {
+        x.sync_length = boost::lexical_cast<uint32_t>(args[++i]);
+      }
+      else
+      {
+        throw boost::bad_lexical_cast();
       }
-    }
-    else
-    {
-      search_num_threads = DEFAULT_NUM_THREADS;
     }
   }
-  std::cout << "Starting vanity search with " << search_num_threads << " threads..." << std::endl;
-  search_active=true;
-
-  if (single_word_search)
-  {
-    for (int i=0;i<search_num_threads;i++) search_threads.push_back(std::thread(search_thread_single_word, i, search_word));
-  }
-  else
+  catch(boost::bad_lexical_cast& e)
   {
-    for (int i=0;i<search_num_threads;i++) search_threads.push_back(std::thread(search_thread,i));
+    fail_msg_writer() << "Expected default, records <n>, ms <milliseconds>, fsync on|off or sync_length <letters>" << std::endl;
+    return true;
   }
+  options::durability = x;
+  success_msg_writer() << "Output durability changed, takes effect on the next start" << std::endl;
   return true;
 }
 
 //--------------------------------------------------------------------------------
 
-bool stop_search(const std::vector<std::string> &args)
+//keyspace [off | random | <base spend key>] [<keys>]
+bool set_keyspace(const std::vector<std::string> &args)
 {
-  if (!search_active)
+  if (args.empty())
   {
-    std::cout << "Search is not active.  No action taken." << std::endl;
+    if (!options::walk)
+    {
+      std::cout << "Random keys, no key-space walk" << std::endl;
+      return true;
+    }
+    std::cout << "Walking the key space from "
+              << (options::walk_random_base ? std::string("a new random base key") : "the base key with fingerprint " + key_fingerprint(options::walk_base));
+    if (options::walk_keys != 0) std::cout << ", " << options::walk_keys << " keys";
+    std::cout << std::endl;
     return true;
   }
-  std::cout << "Stopping Vanity Search..." << std::endl;
-  search_active=false;
-  for (size_t i=0;i<search_threads.size(); i++) search_threads[i].join();
-  search_threads.clear(); //Delete all threads from memory.
-  std::cout << "Vanity Search Stopped" << std::endl;
-  my_ostream.close();
+
+  std::string base = boost::to_lower_copy(args[0]);
+  if (base == "off")
+  {
+    options::walk = false;
+    success_msg_writer() << "Random keys from the next start" << std::endl;
+    return true;
+  }
+
+  crypto::secret_key base_key;
+  uint64_t keys = 0;
+  try
+  {
+    if (base != "random" && !epee::string_tools::hex_to_pod(base, base_key)) throw boost::bad_lexical_cast();
+    if (args.size() > 1) keys = boost::lexical_cast<uint64_t>(args[1]);
+  }
+  catch(boost::bad_lexical_cast& e)
+  {
+    fail_msg_writer() << "Expected keyspace off, or keyspace random or <64 hex digit spend key> followed by an optional number of keys" << std::endl;
+    return true;
+  }
+
+  options::walk             = true;
+  options::walk_random_base = (base == "random");
+  options::walk_keys        = keys;
+  if (!options::walk_random_base)
+  {
+    sc_reduce32((unsigned char *) &base_key);
+    options::walk_base = base_key;
+  }
+  success_msg_writer() << "Key-space walk takes effect on the next start" << std::endl;
   return true;
 }
 
 //--------------------------------------------------------------------------------
 
-bool show_results(const std::vector<std::string> &args)
+//stats [every <seconds> | off]
+//checkpoint <file> writes one now, checkpoint <file> every <seconds> also
+//rewrites it while searching and when the search stops
+bool set_checkpoint(const std::vector<std::string> &args)
 {
-  int  length_threshold;
-  char first_letter_filter;
-  bool filter_by_length=false;
-  bool filter_by_letter=false;
-  //If arguments are supplied in the form of single letters, only show results beginning with that letter.
-
-  if (args.size() == 1)
+  boost::lock_guard<boost::mutex> control_lock(search_control_lock);
+  if (args.empty())
   {
-    try
-    {
-      length_threshold = boost::lexical_cast<int>(args[0]);
-      filter_by_length = true;
-      std::cout << "Showing all words with length >= "
-                << length_threshold << std::endl
-                << "------------------------" << std::endl;
-    }
-    catch(boost::bad_lexical_cast& e)
-    {
-      if (args[0].length() > 1)
-      {
-        fail_msg_writer() << "Expected single letter or number or both" << std::endl;
-        return true;
-      }
-      else
-      {
-        first_letter_filter = args[0][0];
-        filter_by_letter = true;
-        std::cout << "Showing all words starting with \""
-                  << first_letter_filter << "\"" << std::endl
-                  << "------------------------" << std::endl;
-      }
-    }
+    boost::lock_guard<boost::mutex> lock(checkpoint_lock);
+    if (checkpoint_filename.empty()) std::cout << "No periodic checkpoints" << std::endl;
+    else std::cout << "Checkpoint to " << checkpoint_filename << " every " << checkpoint_seconds << " seconds and on stop" << std::endl;
+    return true;
   }
-  else if (!args.empty())
+  if (boost::to_lower_copy(args[0]) == "off")
   {
-    filter_by_letter = true;
-    filter_by_length = true;
-    try{
-      length_threshold    = boost::lexical_cast<int>(args[0]);
-      if (args[1].length() == 1)
-        first_letter_filter = args[1][0];
-      else
-      {
-        fail_msg_writer() << "Expected a number and a single letter in either order" << std::endl;
-        return true;
-      }
-    }
-    catch(boost::bad_lexical_cast& e){
-      try{
-        length_threshold    = boost::lexical_cast<int>(args[1]);
-        if (args[0].length() == 1)
-          first_letter_filter = args[0][0];
-        else
-        {
-          fail_msg_writer() << "Expected a number and a single letter in either order" << std::endl;
-          return true;
-        }
-      }
-      catch(boost::bad_lexical_cast& e){
-        fail_msg_writer() << "Expected a number and a single letter in either order" << std::endl;
-        return true;
-      }
-    }
-    std::cout << "Showing all words starting with \"" << first_letter_filter
-              << "\" with length >= " << length_threshold << std::endl
-              << "------------------------" << std::endl;
+    boost::lock_guard<boost::mutex> lock(checkpoint_lock);
+    checkpoint_filename.clear();
+    checkpoint_seconds = 0;
+    success_msg_writer() << "Periodic checkpoints off" << std::endl;
+    return true;
   }
-  else
+
+  uint32_t seconds = 0;
+  try
   {
-    std::cout << "Showing all found words:" << std::endl
-              << "------------------------" << std::endl;
+    if (args.size() > 1)
+    {
+      if (boost::to_lower_copy(args[1]) != "every" || args.size() < 3) throw boost::bad_lexical_cast();
+      seconds = boost::lexical_cast<uint32_t>(args[2]);
+      if (seconds == 0) throw boost::bad_lexical_cast();
+    }
   }
-
-  std::vector<std::string> found_words_vec;
-  for (const auto & x : found_words)
+  catch(boost::bad_lexical_cast& e)
   {
-    if ((filter_by_letter && x.first[0] != toupper(first_letter_filter))
-        || (filter_by_length && x.first.length() < length_threshold)) continue;
-
-    found_words_vec.push_back(x.first);
+    fail_msg_writer() << "Expected checkpoint <file> [every <seconds>] or checkpoint off" << std::endl;
+    return true;
   }
-  std::sort(found_words_vec.begin(), found_words_vec.end());
-  int line_width = 0;
-  for (const std::string & x : found_words_vec)
+
+  boost::lock_guard<boost::mutex> lock(checkpoint_lock);
+  if (seconds != 0)
   {
-    std::cout << x << " ";
-    line_width += x.length()+1;
-    if (line_width > LINE_WIDTH_LIMIT)
+    if (options::retention != retention_mode::all)
     {
-      std::cout << std::endl;
-      line_width = 0;
+      fail_msg_writer() << "checkpoints need retention all, top-K sets are not saved" << std::endl;
+      return true;
     }
+    checkpoint_filename = args[0];
+    checkpoint_seconds  = seconds;
+    success_msg_writer() << "Checkpoint to " << args[0] << " every " << seconds << " seconds and on stop" << std::endl;
+  }
+  if ((search_active || current_job.search_id != 0) && write_checkpoint(args[0]))
+  {
+    success_msg_writer() << "Checkpoint written to " << args[0] << std::endl;
   }
-  if (line_width != 0) std::cout << std::endl;
-  std::cout << "------------------------" << std::endl;
-
   return true;
 }
 
-//-------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------
 
-bool show_addresses(const std::vector<std::string> &args)
+bool show_stats(const std::vector<std::string> &args)
 {
-  if (args.empty())
+  if (!args.empty())
   {
-    fail_msg_writer() << "Expected search word" << std::endl;
+    uint32_t seconds = 0;
+    try
+    {
+      if (boost::to_lower_copy(args[0]) == "every" && args.size() > 1) seconds = boost::lexical_cast<uint32_t>(args[1]);
+      else if (boost::to_lower_copy(args[0]) != "off") throw boost::bad_lexical_cast();
+    }
+    catch(boost::bad_lexical_cast& e)
+    {
+      fail_msg_writer() << "Expected stats, stats every <seconds> or stats off" << std::endl;
+      return true;
+    }
+    stats_report_seconds = seconds;
+    if (seconds == 0) success_msg_writer() << "Periodic stats off" << std::endl;
+    else success_msg_writer() << "Printing stats every " << seconds << " seconds while searching" << std::endl;
     return true;
   }
 
-  std::cout << "Showing results for \"" << args[0] << "\"" << "\n"
-            << "-------------------------" << std::endl;
-  auto search_results = found_words.find(boost::to_upper_copy(args[0]));
-  if (search_results == found_words.end())
-  {
-    std::cout << "NONE FOUND" << std::endl;
-  }
-  else
+  if (!search_active)
   {
-    std::vector<std::string> address_vec = search_results->second;
-    for (const std::string & x : address_vec)
-    {
-      std::cout << x << std::endl;
-    }
+    std::cout << "Search is not active." << std::endl;
+    return true;
   }
-  std::cout << "------------------------" << std::endl;
+  thread_safe_print(format_stats());
   return true;
 }
 
 //--------------------------------------------------------------------------------
 
-bool set_prefix(const std::vector<std::string> &args)
+//throttle [off | <percent> [load [<max load>]]]
+bool set_throttle(const std::vector<std::string> &args)
 {
   if (args.empty())
   {
-    std::stringstream ss;
+    std::cout << "CPU budget: ";
+    if (options::cpu_budget == 0) std::cout << "unthrottled";
+    else std::cout << options::cpu_budget << "% of " << host_cpu_limits.effective << " CPUs";
+    if (options::load_limit > 0)
+    {
+      double load = 0;
+      read_load_average(load);
+      std::cout << ", backing off above load " << options::load_limit << " (now " << load << ")";
+    }
+    if (search_active) std::cout << ", thread duty cycle " << (int) (target_duty() * 100) << "%";
+    std::cout << std::endl;
+    return true;
+  }
 
-    ss << "0x" << std::uppercase << std::setfill('0') << std::setw(4) << std::hex << options::address_prefix;
-    std::cout << "Current Coin         = " << options::address_prefix_label << "\n"
-              << "Current Prefix       = " << options::address_prefix << "\n"
-              << "Current Prefix (hex) = " << ss.str() << std::endl;
+  if (boost::to_lower_copy(args[0]) == "off")
+  {
+    options::cpu_budget = 0;
+    options::load_limit = 0;
+    load_scale = 1;
+    success_msg_writer() << "Throttle off" << std::endl;
     return true;
   }
 
-  auto muh_prefix = prefix_map.find(boost::to_upper_copy(args[0]));
-  if (muh_prefix == prefix_map.end())
+  uint32_t budget;
+  double   limit = 0;
+  try
   {
-    try{
-      options::address_prefix       = boost::lexical_cast<uint64_t>(args[0]);
-      options::address_prefix_label = "NA";
-    }
-    catch(boost::bad_lexical_cast& e){
-      fail_msg_writer() << "Invalid prefix choice" << std::endl;
-      return true;
+    budget = boost::lexical_cast<uint32_t>(args[0]);
+    if (args.size() > 1)
+    {
+      if (boost::to_lower_copy(args[1]) != "load") throw boost::bad_lexical_cast();
+      limit = (args.size() > 2) ? boost::lexical_cast<double>(args[2]) : host_cpu_limits.effective;
     }
   }
-  else
+  catch(boost::bad_lexical_cast& e)
+  {
+    fail_msg_writer() << "Expected throttle off or throttle <percent> [load [<max load>]]" << std::endl;
+    return true;
+  }
+  if (budget > 100)
   {
-    options::address_prefix       = muh_prefix->second;
-    options::address_prefix_label = muh_prefix->first;
+    fail_msg_writer() << "CPU budget is a percentage of the usable CPUs, 0 to 100" << std::endl;
+    return true;
   }
 
-  success_msg_writer() << "Prefix successfully updated" << std::endl;
+  options::cpu_budget = budget;
+  options::load_limit = limit;
+  load_scale          = 1;
+  next_load_check_ms  = 0;
+  std::stringstream ss;
+  ss << "CPU budget ";
+  if (budget == 0) ss << "unthrottled";
+  else ss << budget << "%";
+  if (limit > 0) ss << ", backing off above load " << limit;
+  success_msg_writer() << ss.str() << std::endl;
   return true;
 }
 
 //--------------------------------------------------------------------------------
 
-bool set_params(const std::vector<std::string> &args)
+bool set_retention(const std::vector<std::string> &args)
 {
-  if(args.empty())
+  if (args.empty())
   {
-    std::cout << "     Min Start Pos: " << options::min_start_pos << "\n"
-              << "     Max Start Pos: " << options::max_start_pos << "\n"
-              << "Search Word Length: " << options::search_word_length << std::endl;
+    std::cout << "Retention: ";
+    switch (options::retention)
+    {
+      case retention_mode::all:      std::cout << "all matches" << std::endl; break;
+      case retention_mode::per_word: std::cout << "best " << options::retention_k << " per word" << std::endl; break;
+      case retention_mode::global:   std::cout << "best " << options::retention_k << " overall" << std::endl; break;
+    }
     return true;
   }
-  else if (args.size() < 3)
+
+  if (search_active)
   {
-    fail_msg_writer() << "Expected four parameter values, see 'help' command." << std::endl;
+    fail_msg_writer() << "Cannot change retention while a search is active" << std::endl;
     return true;
   }
 
-  try
+  std::string mode = boost::to_lower_copy(args[0]);
+  uint32_t k = options::retention_k;
+  if (args.size() > 1)
   {
-    options::min_start_pos      = boost::lexical_cast<int>(args[0]);
-    options::max_start_pos      = boost::lexical_cast<int>(args[1]);
-    options::search_word_length = boost::lexical_cast<int>(args[2]);
-    success_msg_writer() << "Search parameters changed" << std::endl;
+    try
+    {
+      k = boost::lexical_cast<uint32_t>(args[1]);
+    }
+    catch(boost::bad_lexical_cast& e)
+    {
+      fail_msg_writer() << "Expected a positive integer for K" << std::endl;
+      return true;
+    }
+  }
+  if (k == 0)
+  {
+    fail_msg_writer() << "Expected a positive integer for K" << std::endl;
     return true;
   }
-  catch(boost::bad_lexical_cast& e)
+
+  if (mode == "all")         options::retention = retention_mode::all;
+  else if (mode == "word")   options::retention = retention_mode::per_word;
+  else if (mode == "global") options::retention = retention_mode::global;
+  else
   {
-    fail_msg_writer() << "Expected three integers" << std::endl;
+    fail_msg_writer() << "Expected all, word or global" << std::endl;
     return true;
+  }
+  options::retention_k = k;
 
+  //Matches kept under the old policy are not carried over
+  {
+    boost::lock_guard<boost::mutex> lock(my_output_lock);
+    for (const auto & x : *std::atomic_load(&live_jobs))
+    {
+      x->retained_set = retained_matches(options::retention, options::retention_k);
+      x->found_words.clear();
+    }
   }
+  success_msg_writer() << "Retention changed" << std::endl;
+  return true;
 }
 
 //--------------------------------------------------------------------------------
@@ -602,13 +3639,30 @@ bool help(const std::vector<std::string> &args)
 
 void bind_commands()
 {
-  m_cmd_binder.set_handler("start"            , boost::bind(&start_search, _1)       , "start <word file> <output file> [num_threads]- start address search");
+  m_cmd_binder.set_handler("start"            , boost::bind(&start_search, _1)       , "start <word file> <output file> | jobs [num_threads] [compact | scatter | physical | <cpu list>] - start address search, optionally pinning threads to CPUs.  Jobs added with the job command are searched too.  A named pipe as the word file, or - for stdin with --run, is searched as the words arrive");
+  m_cmd_binder.set_handler("reload"           , boost::bind(&reload_words, _1)       , "reload <word file> [job] - switch the running search, or one of its jobs, to a new word file without stopping it");
+  m_cmd_binder.set_handler("job"              , boost::bind(&manage_jobs, _1)        , "job [add <name> <word file> <output file> [prefix] [quota] | remove <name> | list] - search several word lists with their own output on the same keys");
   m_cmd_binder.set_handler("stop"             , boost::bind(&stop_search, _1)        , "stop - stop address search");
+  m_cmd_binder.set_handler("pause"            , boost::bind(&pause_search, _1)       , "pause - park the search threads, keeping their keys, counters and the output file");
+  m_cmd_binder.set_handler("resume"           , boost::bind(&resume_search, _1)      , "resume [<checkpoint file> [threads]] - continue a paused search where it left off, or a stopped one from a checkpoint, replacing the current jobs");
+  m_cmd_binder.set_handler("checkpoint"       , boost::bind(&set_checkpoint, _1)     , "checkpoint [<file> [every <seconds>] | off] - save the settings, jobs, hit counts, counters and key-space walk progress now, or also periodically and on stop, for resume <file>");
+  m_cmd_binder.set_handler("threads"          , boost::bind(&set_threads, _1)        , "threads <n> - add or remove threads of the running search");
   m_cmd_binder.set_handler("results"          , boost::bind(&show_results, _1)       , "results - [a-z] [0-9] show found words starting with a certain letter and/or greater than a certain length");
   m_cmd_binder.set_handler("show_addresses"   , boost::bind(&show_addresses, _1)     , "show_addresses <word> - show addresses found for <word>");
   m_cmd_binder.set_handler("set_params"       , boost::bind(&set_params, _1)         , "set_params <min start pos> <max start pos> <search word length>");
+  m_cmd_binder.set_handler("set_quota"        , boost::bind(&set_quota, _1)          , "set_quota [n] - stop matching a word once it has been found n times (0 = unlimited).  QUOTA=<n> after a word in the word file overrides it");
+  m_cmd_binder.set_handler("set_retention"    , boost::bind(&set_retention, _1)      , "set_retention [all | word <k> | global <k>] - keep every match, or only the best k per word or overall");
+  m_cmd_binder.set_handler("limit"            , boost::bind(&set_limits, _1)         , "limit [off | matches <n> | all_words | time <seconds> | cpu <seconds>]... - end searches by themselves after n matches, once every word is found or after a time limit");
+  m_cmd_binder.set_handler("index_cache"      , boost::bind(&set_index_cache, _1)    , "index_cache [off | <directory>] - keep compiled word indexes keyed by word file hash and set_params values, so the same list loads without parsing next time");
+  m_cmd_binder.set_handler("set_format"       , boost::bind(&set_format, _1)         , "set_format [text | jsonl | csv | binary] - write matches as text blocks, JSON lines, CSV rows of word, position, coin, address, keys, mnemonic, thread and timestamp, or a compact binary log for export");
+  m_cmd_binder.set_handler("export"           , boost::bind(&export_log, _1)         , "export <binary log> <output file> [text | jsonl | csv] [threads] - expand a binary match log, deriving addresses, view keys and mnemonics on several threads");
+  m_cmd_binder.set_handler("durability"       , boost::bind(&set_durability, _1)     , "durability [default | records <n> | ms <t> | fsync on|off | sync_length <n>]... - write matches once n are waiting or every t ms, optionally fsync each write, and write and sync words of n letters or more at once");
+  m_cmd_binder.set_handler("keyspace"         , boost::bind(&set_keyspace, _1)       , "keyspace [off | random | <base spend key>] [<keys>] - check consecutive keys from a base key, shared out in batches that idle threads steal, optionally ending after that many keys.  Each batch starts from a hash of the base key, so keys found in the same batch can be reached from each other.  Keep the base key secret, and don't share a walk between customers");
+  m_cmd_binder.set_handler("stats"            , boost::bind(&show_stats, _1)         , "stats [every <seconds> | off] - show current and rolling addresses/sec per thread, matches and writer queue, or print them periodically");
+  m_cmd_binder.set_handler("throttle"         , boost::bind(&set_throttle, _1)       , "throttle [off | <percent> [load [<max load>]]] - keep the search under a share of the usable CPUs, optionally backing off when the load average is higher");
   m_cmd_binder.set_handler("set_prefix"       , boost::bind(&set_prefix, _1)         , "set_prefix <XMR | XMR_TEST | AEON | number> - Set prefix either to a given number of specify a coin");
   m_cmd_binder.set_handler("show_success_msg" , boost::bind(&toggle_success_msg, _1) , "show_success_msg - toggles whether to show a message when an address is found");
+  m_cmd_binder.set_handler("autotune"         , boost::bind(&autotune, _1)           , "autotune <word file> [seconds per trial] - time thread counts and batch sizes and keep the fastest as the default");
   m_cmd_binder.set_handler("help"             , boost::bind(&help, _1)               , "help - show this help");
   //We don't need an exit command.  Exit is built in.
 }
@@ -621,19 +3675,52 @@ int main(int argc, char* argv[])
   std::cout << "--------------XMR vanity address generator--------------" << std::endl;
   std::cout << "Type \"help\" for a list of commands" << std::endl;
 
+  init_default_threads();
+  load_autotune();
   bind_commands();
-  m_cmd_binder.run_handling(std::string("[VANITY SEARCH]: "), "");
+
+  //--run "<command>" "<command>"... runs the commands in order without a
+  //console, then waits for the search they start to hit its job limit.  The
+  //exit status is 1 if a command is unknown or a search fails to start.
+  int exit_status = 0;
+  if (argc > 1 && std::string(argv[1]) == "--run")
+  {
+    console_on_stdin = false;
+    for (int i=2; i<argc; i++)
+    {
+      std::cout << "[VANITY SEARCH]: " << argv[i] << std::endl;
+      std::string command = boost::to_lower_copy(std::string(argv[i]));
+      command = command.substr(0, command.find(' '));
+      uint64_t started = searches_started;
+      if (!m_cmd_binder.process_command_str(argv[i]))
+      {
+        fail_msg_writer() << "unknown command: " << argv[i] << std::endl;
+        exit_status = 1;
+        break;
+      }
+      if ((command == "start" || command == "resume") && searches_started == started)
+      {
+        fail_msg_writer() << "the search did not start" << std::endl;
+        exit_status = 1;
+        break;
+      }
+    }
+    while (search_active) std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+  else
+  {
+    m_cmd_binder.run_handling(std::string("[VANITY SEARCH]: "), "");
+  }
 
   //Code below is run when the exit command is given.
-  if (search_active)
   {
-    std::cout << "Stopping Vanity Search..." << std::endl;
-    search_active=false;
-    for (size_t i=0;i<search_threads.size(); i++) search_threads[i].join();
-    std::cout << "Vanity Search Stopped" << std::endl;
-    my_ostream.close();
+    boost::lock_guard<boost::mutex> control_lock(search_control_lock);
+    if (search_active) finish_search();
   }
+  stop_stats();
+  shutdown_workers();
+  for (const auto & x : *std::atomic_load(&live_jobs)) stop_word_stream(*x);
 
 
-  return 0;
+  return exit_status;
 }
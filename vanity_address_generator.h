@@ -45,6 +45,26 @@
 #define DEFAULT_MIN_WORD_LENGTH       4
 #define DEFAULT_MAX_WORD_LENGTH       11
 #define DEFAULT_NUM_THREADS           4
+#define DEFAULT_BATCH_SIZE            64  //Candidates between checks of the worker pool state
+#define DEFAULT_TRIAL_SECONDS         3   //Length of each autotune trial
+#define AUTOTUNE_FILENAME             "vanity_autotune.txt"
+#define INDEX_CACHE_DIR               "vanity_index_cache"  //Compiled word indexes, see index_cache.h
+#define DEFAULT_WORD_QUOTA            0   //Matches per word before it is retired, 0 = unlimited
+#define DEFAULT_RETENTION_K           10
+#define MATCH_QUEUE_SIZE              4096  //Matches waiting for the writer thread, a power of two
+#define WRITER_IDLE_MS                20  //Writer thread sleep when the match queue is empty
+#define MAX_THROTTLE_PAUSE            0.25  //Longest throttle sleep after one batch, keeps pause and stop responsive
+#define LOAD_CHECK_SECONDS            5   //How often the load average backoff rereads /proc/loadavg
+#define MIN_LOAD_SCALE                0.05  //Load backoff never takes the duty cycle below this share
+#define MAX_SEARCH_THREADS            1024
+#define DEFAULT_JOB_NAME              "default"  //Job defined by the word file and output file given to start
+#define WALK_CHUNK_BATCHES            16  //Batches a thread takes at once from an unbounded key-space walk
+#define WALK_IDLE_MS                  20  //Sleep of a thread with no batches left while the last ones finish
+#define EXPORT_WINDOW_MATCHES         65536  //Binary log records expanded per round of the export command
+#define CHECKPOINT_SYNC_SECONDS       10  //Longest wait for the writer to sync the outputs before a checkpoint
+#define STREAM_CHUNK_BYTES            (4 << 20)  //A streamed word list is indexed in chunks of about this size...
+#define STREAM_PUBLISH_MS             250  //...or of whatever has arrived once the oldest line has waited this long
+#define STATS_WINDOW_SECONDS          60  //Rolling average window of the stats command
 
 #define DEFAULT_SEARCH_LENGTH         6
 
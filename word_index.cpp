@@ -0,0 +1,582 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "word_index.h"
+#include "mapped_file.h"
+#include "number_list.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+//Smallest chunk of a word file worth a loader thread of its own
+static const size_t min_load_chunk_bytes = 1 << 20;
+
+//--------------------------------------------------------------------------------
+//Last start position of words without a position column
+static uint32_t last_default_pos(const index_params& params)
+{
+  return std::min(params.max_start_pos, params.max_position);
+}
+//--------------------------------------------------------------------------------
+static bool is_column_space(char c) { return c == ' ' || c == '\t'; }
+//--------------------------------------------------------------------------------
+//A word followed by optional columns: a position set and/or "QUOTA=<n>".
+//Returns false for lines that are not searchable words.  Works on the line
+//in place, so the word is the only string built for most lines.
+static bool parse_word_range(const char* begin, const char* end, const index_params& params, word_entry& entry, std::vector<uint32_t>& positions)
+{
+  while (begin < end && isspace((unsigned char) *begin)) begin++;
+  while (end > begin && isspace((unsigned char) end[-1])) end--;
+  if (begin == end) return false;
+
+  const char* word_end = begin;
+  while (word_end < end && !is_column_space(*word_end)) word_end++;
+  if ((size_t) (word_end - begin) < params.key_length) return false;
+
+  entry.word.assign(begin, word_end);
+  for (char & c : entry.word)
+  {
+    if (c == '\'' || c == '/' || c == '&') return false;
+    c = toupper((unsigned char) c);
+  }
+  entry.quota = params.default_quota;
+  positions.clear();
+
+  const char* column = word_end;
+  while (true)
+  {
+    while (column < end && is_column_space(*column)) column++;
+    if (column == end) return true;
+    const char* column_end = column;
+    while (column_end < end && !is_column_space(*column_end)) column_end++;
+
+    std::string x(column, column_end);
+    if (x.length() >= 6 && boost::iequals(x.substr(0, 6), "QUOTA="))
+    {
+      try
+      {
+        entry.quota = boost::lexical_cast<uint32_t>(x.substr(6));
+      }
+      catch(boost::bad_lexical_cast& e)
+      {
+        return false;
+      }
+    }
+    else if (!isdigit((unsigned char) x[0]) || !parse_number_list(x, params.max_position, positions))
+    {
+      return false;
+    }
+    column = column_end;
+  }
+}
+//--------------------------------------------------------------------------------
+bool parse_word_line(const std::string& line, const index_params& params, word_entry& entry, std::vector<uint32_t>& positions)
+{
+  return parse_word_range(line.data(), line.data() + line.size(), params, entry, positions);
+}
+//--------------------------------------------------------------------------------
+void set_active_positions(word_index& index)
+{
+  index.active_positions.clear();
+  for (uint32_t i=0; i<index.positions.size(); i++)
+  {
+    if (!index.positions[i].empty()) index.active_positions.push_back(i);
+  }
+}
+//--------------------------------------------------------------------------------
+std::vector<const word_index*> index_parts(const word_index& index)
+{
+  if (index.segments.empty()) return std::vector<const word_index*>(1, &index);
+
+  std::vector<const word_index*> parts;
+  for (const auto & x : index.segments) parts.push_back(x.get());
+  return parts;
+}
+//--------------------------------------------------------------------------------
+//A top index listing the given segments, whose first ids are already set
+static std::shared_ptr<word_index> segmented_index(uint32_t key_length, std::vector<std::shared_ptr<const word_index>> segments)
+{
+  auto index = std::make_shared<word_index>();
+  index->key_length = key_length;
+  index->words      = std::make_shared<std::vector<word_entry>>();
+  index->segments   = std::move(segments);
+
+  std::vector<bool> active;
+  for (const auto & x : index->segments)
+  {
+    index->word_count += x->word_count;
+    if (active.size() < x->positions.size()) active.resize(x->positions.size(), false);
+    for (uint32_t pos : x->active_positions) active[pos] = true;
+  }
+  for (uint32_t i=0; i<active.size(); i++)
+  {
+    if (active[i]) index->active_positions.push_back(i);
+  }
+  return index;
+}
+//--------------------------------------------------------------------------------
+static uint64_t hash_word_range(uint64_t hash, const char* begin, const char* end)
+{
+  uint64_t line_hash = WORD_LIST_HASH_SEED;
+  for (const char* c=begin; c<end; c++)
+  {
+    line_hash ^= (unsigned char) *c;
+    line_hash *= WORD_LIST_HASH_PRIME;
+  }
+  return hash * WORD_LIST_HASH_PRIME + line_hash;
+}
+//--------------------------------------------------------------------------------
+uint64_t hash_word_line(uint64_t hash, const std::string& line)
+{
+  return hash_word_range(hash, line.data(), line.data() + line.size());
+}
+//--------------------------------------------------------------------------------
+std::shared_ptr<word_index> without_words(const word_index& old_index, const std::unordered_set<std::string>& retiring)
+{
+  if (!old_index.segments.empty())
+  {
+    std::vector<std::shared_ptr<const word_index>> segments;
+    for (const auto & x : old_index.segments)
+    {
+      std::shared_ptr<const word_index> kept = without_words(*x, retiring);
+      segments.push_back(kept->word_count == x->word_count ? x : kept);  //Untouched segments stay shared
+    }
+    return segmented_index(old_index.key_length, std::move(segments));
+  }
+
+  auto new_index = std::make_shared<word_index>();
+  new_index->key_length = old_index.key_length;
+  new_index->words      = old_index.words;
+  new_index->positions.resize(old_index.positions.size());
+
+  const std::vector<word_entry> & words = *old_index.words;
+  std::unordered_set<uint32_t> removed;
+  for (uint32_t pos : old_index.active_positions)
+  {
+    for (const auto & bucket : old_index.positions[pos])
+    {
+      std::vector<uint32_t> kept;
+      for (uint32_t id : bucket.second)
+      {
+        if (retiring.find(words[id].word) == retiring.end()) kept.push_back(id);
+        else removed.insert(id);
+      }
+      if (!kept.empty()) new_index->positions[pos].emplace(bucket.first, std::move(kept));
+    }
+  }
+  new_index->word_count  = old_index.word_count - removed.size();
+  new_index->source_hash = old_index.source_hash;
+  new_index->first_id    = old_index.first_id;
+  set_active_positions(*new_index);
+  return new_index;
+}
+//--------------------------------------------------------------------------------
+//One part of an index copied, or taken from the previous copy's parts.
+//Memory is allocated by the calling thread, so under the default
+//first-touch policy it lands on that thread's NUMA node.
+static std::shared_ptr<const word_index> replicate_part(const std::shared_ptr<const word_index>& old_part, const replica_parts& previous,
+                                                        replica_parts& parts)
+{
+  auto copied = previous.segments.find(old_part);
+  if (copied != previous.segments.end())
+  {
+    parts.segments.insert(*copied);
+    parts.words[old_part->words] = copied->second->words;
+    return copied->second;
+  }
+
+  auto copied_words = previous.words.find(old_part->words);
+  std::shared_ptr<const std::vector<word_entry>> words;
+  if (copied_words != previous.words.end()) words = copied_words->second;
+  else words = std::make_shared<std::vector<word_entry>>(*old_part->words);
+  parts.words[old_part->words] = words;
+
+  auto new_index = std::make_shared<word_index>();
+  new_index->key_length       = old_part->key_length;
+  new_index->word_count       = old_part->word_count;
+  new_index->source_hash      = old_part->source_hash;
+  new_index->words            = words;
+  new_index->positions        = old_part->positions;
+  new_index->active_positions = old_part->active_positions;
+  new_index->first_id         = old_part->first_id;
+  parts.segments[old_part] = new_index;
+  return new_index;
+}
+//--------------------------------------------------------------------------------
+std::shared_ptr<const word_index> replicate_index(const std::shared_ptr<const word_index>& old_index, replica_parts& parts)
+{
+  replica_parts previous;
+  std::swap(previous, parts);
+  if (old_index->segments.empty()) return replicate_part(old_index, previous, parts);
+
+  std::vector<std::shared_ptr<const word_index>> segments;
+  for (const auto & x : old_index->segments) segments.push_back(replicate_part(x, previous, parts));
+  return segmented_index(old_index->key_length, std::move(segments));
+}
+//--------------------------------------------------------------------------------
+//Rough heap footprint, for reporting only
+size_t index_memory_bytes(const word_index& index)
+{
+  static const size_t sso_capacity  = 15;
+  static const size_t node_overhead = 2 * sizeof(void *);
+
+  size_t total = 0;
+  for (const auto & x : index.segments) total += index_memory_bytes(*x);
+  for (const word_entry & x : *index.words)
+  {
+    total += sizeof(word_entry) + (x.word.capacity() > sso_capacity ? x.word.capacity() + 1 : 0);
+  }
+  for (const position_table & table : index.positions)
+  {
+    total += sizeof(position_table) + table.bucket_count() * sizeof(void *);
+    for (const auto & bucket : table)
+    {
+      total += node_overhead + sizeof(bucket) + bucket.second.capacity() * sizeof(uint32_t);
+    }
+  }
+  return total;
+}
+//--------------------------------------------------------------------------------
+word_index_builder::word_index_builder(const index_params& a_params)
+  : params(a_params)
+  , words(std::make_shared<std::vector<word_entry>>())
+  , index(std::make_shared<word_index>())
+{
+  index->key_length = params.key_length;
+}
+//--------------------------------------------------------------------------------
+void word_index_builder::add(const word_entry& entry, const std::vector<uint32_t>& positions)
+{
+  uint32_t id = words->size();
+  words->push_back(entry);
+  index->word_count++;
+
+  std::string key = entry.word.substr(0, params.key_length);
+  auto add_at = [&](uint32_t pos)
+  {
+    if (pos >= index->positions.size()) index->positions.resize(pos + 1);
+    std::vector<uint32_t> & ids = index->positions[pos][key];
+    if (ids.empty() || ids.back() != id) ids.push_back(id);  //Repeated positions in the column
+  };
+
+  if (positions.empty())
+  {
+    for (uint32_t pos=params.min_start_pos; pos<=last_default_pos(params); pos++) add_at(pos);
+  }
+  else
+  {
+    for (uint32_t pos : positions) add_at(pos);
+  }
+}
+//--------------------------------------------------------------------------------
+std::shared_ptr<word_index> word_index_builder::finish()
+{
+  index->words = words;
+  set_active_positions(*index);
+  return index;
+}
+
+//------------------------------------------------------------------------------
+//
+//Parallel word file loading.  Each thread parses and filters its own chunk of
+//the mapped file.  The position tables are then filled in parallel too, each
+//thread taking every n-th start position and going through the chunks in
+//file order, so word ids come out as a sequential load would give them.
+//
+//------------------------------------------------------------------------------
+struct parsed_chunk
+{
+  std::vector<word_entry> entries;
+  std::vector<uint32_t>   position_data;   //Explicit positions of all entries, back to back
+  std::vector<size_t>     position_ends;   //End of each entry's positions in position_data
+  std::vector<size_t>     position_words;  //Entries at each start position, to size the tables
+  uint64_t                lines {0};
+  uint64_t                hash  {0};       //Of the chunk's lines alone, folded from 0
+  uint64_t                scale {1};       //WORD_LIST_HASH_PRIME to the power of lines
+};
+//--------------------------------------------------------------------------------
+static void parse_chunk(const char* begin, const char* end, const index_params& params,
+                        const std::function<bool(const word_entry&)>& skip, parsed_chunk& chunk)
+{
+  word_entry entry;
+  std::vector<uint32_t> positions;
+  auto count_at = [&chunk](uint32_t pos)
+  {
+    if (pos >= chunk.position_words.size()) chunk.position_words.resize(pos + 1, 0);
+    chunk.position_words[pos]++;
+  };
+
+  while (begin < end)
+  {
+    const char* line_end = (const char*) memchr(begin, '\n', end - begin);
+    if (!line_end) line_end = end;
+
+    chunk.hash   = hash_word_range(chunk.hash, begin, line_end);
+    chunk.scale *= WORD_LIST_HASH_PRIME;
+    chunk.lines++;
+    if (parse_word_range(begin, line_end, params, entry, positions) && !skip(entry))
+    {
+      if (positions.empty())
+      {
+        for (uint32_t pos=params.min_start_pos; pos<=last_default_pos(params); pos++) count_at(pos);
+      }
+      for (uint32_t pos : positions) count_at(pos);
+      chunk.position_data.insert(chunk.position_data.end(), positions.begin(), positions.end());
+      chunk.position_ends.push_back(chunk.position_data.size());
+      chunk.entries.push_back(std::move(entry));
+    }
+    begin = line_end + 1;
+  }
+}
+//--------------------------------------------------------------------------------
+//Adds every word to the tables of the positions p with p % num_threads == thread_num
+static void fill_positions(const std::vector<parsed_chunk>& chunks, const index_params& params,
+                           uint32_t thread_num, uint32_t num_threads, word_index& index)
+{
+  for (size_t pos=thread_num; pos<index.positions.size(); pos+=num_threads)
+  {
+    size_t num_words = 0;
+    for (const parsed_chunk & x : chunks) num_words += (pos < x.position_words.size()) ? x.position_words[pos] : 0;
+    index.positions[pos].reserve(num_words);
+  }
+
+  uint32_t id = 0;
+  std::string key;
+  for (const parsed_chunk & x : chunks)
+  {
+    for (size_t i=0; i<x.entries.size(); i++, id++)
+    {
+      bool have_key = false;
+      auto add_at = [&](uint32_t pos)
+      {
+        if (pos % num_threads != thread_num) return;
+        if (!have_key)
+        {
+          key.assign(x.entries[i].word, 0, params.key_length);
+          have_key = true;
+        }
+        std::vector<uint32_t> & ids = index.positions[pos][key];
+        if (ids.empty() || ids.back() != id) ids.push_back(id);  //Repeated positions in the column
+      };
+
+      size_t first = (i == 0) ? 0 : x.position_ends[i-1];
+      size_t last  = x.position_ends[i];
+      if (first == last)
+      {
+        for (uint32_t pos=params.min_start_pos; pos<=last_default_pos(params); pos++) add_at(pos);
+      }
+      for (size_t j=first; j<last; j++) add_at(x.position_data[j]);
+    }
+  }
+}
+//--------------------------------------------------------------------------------
+//Up to max_chunks chunks of about the same size, each starting just after a
+//newline so that no line is split.  Chunk i is [bounds[i], bounds[i+1]).
+static std::vector<const char*> split_lines(const char* data, size_t size, uint32_t max_chunks)
+{
+  size_t num_chunks = std::min<size_t>(std::max<uint32_t>(1, max_chunks), size / min_load_chunk_bytes + 1);
+  std::vector<const char*> bounds(num_chunks + 1, data + size);
+  bounds[0] = data;
+  for (size_t i=1; i<num_chunks; i++)
+  {
+    const char* from     = std::max(bounds[i-1], data + size * i / num_chunks);
+    const char* line_end = (from < data + size) ? (const char*) memchr(from, '\n', data + size - from) : nullptr;
+    bounds[i] = line_end ? line_end + 1 : data + size;
+  }
+  return bounds;
+}
+//--------------------------------------------------------------------------------
+std::shared_ptr<word_index> load_word_file(const std::string& filename, const index_params& params, uint32_t max_threads,
+                                           const std::function<bool(const word_entry&)>& skip, word_file_stats& stats)
+{
+  auto start_time = std::chrono::steady_clock::now();
+  mapped_file file;
+  if (!file.open(filename, true)) return nullptr;
+
+  std::vector<const char*>  bounds = split_lines(file.data(), file.size(), max_threads);
+  size_t                    num_chunks = bounds.size() - 1;
+  std::vector<parsed_chunk> chunks(num_chunks);
+  std::vector<std::thread>  threads;
+  for (size_t i=1; i<num_chunks; i++)
+  {
+    threads.push_back(std::thread(parse_chunk, bounds[i], bounds[i+1], std::cref(params), std::cref(skip), std::ref(chunks[i])));
+  }
+  parse_chunk(bounds[0], bounds[1], params, skip, chunks[0]);
+  for (std::thread & x : threads) x.join();
+  threads.clear();
+  file.close();
+
+  auto index = std::make_shared<word_index>();
+  index->key_length = params.key_length;
+  size_t num_words = 0;
+  size_t num_positions = 0;
+  uint64_t hash = WORD_LIST_HASH_SEED;
+  stats.lines = 0;
+  for (const parsed_chunk & x : chunks)
+  {
+    num_words     += x.entries.size();
+    num_positions  = std::max(num_positions, x.position_words.size());
+    hash           = hash * x.scale + x.hash;
+    stats.lines   += x.lines;
+  }
+  index->positions.resize(num_positions);
+
+  uint32_t fill_threads = std::max<size_t>(1, std::min<size_t>(num_chunks, num_positions));
+  for (uint32_t i=1; i<fill_threads; i++)
+  {
+    threads.push_back(std::thread(fill_positions, std::cref(chunks), std::cref(params), i, fill_threads, std::ref(*index)));
+  }
+  fill_positions(chunks, params, 0, fill_threads, *index);
+  for (std::thread & x : threads) x.join();
+
+  auto words = std::make_shared<std::vector<word_entry>>();
+  words->reserve(num_words);
+  for (parsed_chunk & x : chunks)
+  {
+    for (word_entry & entry : x.entries) words->push_back(std::move(entry));
+    x = parsed_chunk();  //Free as we go
+  }
+  index->words       = words;
+  index->word_count  = num_words;
+  index->source_hash = hash;
+  set_active_positions(*index);
+
+  stats.words      = num_words;
+  stats.threads    = num_chunks;
+  stats.from_cache = false;
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  return index;
+}
+//--------------------------------------------------------------------------------
+static void hash_chunk(const char* begin, const char* end, parsed_chunk& chunk)
+{
+  while (begin < end)
+  {
+    const char* line_end = (const char*) memchr(begin, '\n', end - begin);
+    if (!line_end) line_end = end;
+    chunk.hash   = hash_word_range(chunk.hash, begin, line_end);
+    chunk.scale *= WORD_LIST_HASH_PRIME;
+    chunk.lines++;
+    begin = line_end + 1;
+  }
+}
+//--------------------------------------------------------------------------------
+bool hash_word_file(const std::string& filename, uint32_t max_threads, uint64_t& hash, uint64_t& lines)
+{
+  mapped_file file;
+  if (!file.open(filename, true)) return false;
+
+  std::vector<const char*>  bounds = split_lines(file.data(), file.size(), max_threads);
+  std::vector<parsed_chunk> chunks(bounds.size() - 1);
+  std::vector<std::thread>  threads;
+  for (size_t i=1; i<chunks.size(); i++) threads.push_back(std::thread(hash_chunk, bounds[i], bounds[i+1], std::ref(chunks[i])));
+  hash_chunk(bounds[0], bounds[1], chunks[0]);
+  for (std::thread & x : threads) x.join();
+
+  hash  = WORD_LIST_HASH_SEED;
+  lines = 0;
+  for (const parsed_chunk & x : chunks)
+  {
+    hash   = hash * x.scale + x.hash;
+    lines += x.lines;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+//
+//Streamed word lists.  Each chunk read from the stream is indexed on its own
+//and added as a segment.  Whenever the last segment is at least as large as
+//the one before, the two are merged, so segments halve in size or more from
+//the first to the last.
+//
+//------------------------------------------------------------------------------
+std::shared_ptr<word_index> parse_word_segment(const char* begin, const char* end, const index_params& params,
+                                               const std::function<bool(const word_entry&)>& skip, uint64_t& lines)
+{
+  std::vector<parsed_chunk> chunks(1);
+  parse_chunk(begin, end, params, skip, chunks[0]);
+
+  auto index = std::make_shared<word_index>();
+  index->key_length = params.key_length;
+  index->positions.resize(chunks[0].position_words.size());
+  fill_positions(chunks, params, 0, 1, *index);
+  index->word_count = chunks[0].entries.size();
+  index->words      = std::make_shared<std::vector<word_entry>>(std::move(chunks[0].entries));
+  set_active_positions(*index);
+  lines = chunks[0].lines;
+  return index;
+}
+//--------------------------------------------------------------------------------
+static std::shared_ptr<word_index> merge_segments(const word_index& a, const word_index& b)
+{
+  auto index = std::make_shared<word_index>();
+  index->key_length = a.key_length;
+  index->first_id   = a.first_id;
+  index->word_count = a.word_count + b.word_count;
+
+  auto words = std::make_shared<std::vector<word_entry>>();
+  words->reserve(a.words->size() + b.words->size());
+  words->insert(words->end(), a.words->begin(), a.words->end());
+  words->insert(words->end(), b.words->begin(), b.words->end());
+  index->words = words;
+
+  uint32_t offset = a.words->size();
+  index->positions = a.positions;
+  if (index->positions.size() < b.positions.size()) index->positions.resize(b.positions.size());
+  for (uint32_t pos : b.active_positions)
+  {
+    for (const auto & bucket : b.positions[pos])
+    {
+      std::vector<uint32_t> & ids = index->positions[pos][bucket.first];
+      for (uint32_t id : bucket.second) ids.push_back(id + offset);
+    }
+  }
+  set_active_positions(*index);
+  return index;
+}
+//--------------------------------------------------------------------------------
+std::shared_ptr<word_index> append_segment(const std::shared_ptr<const word_index>& index, const std::shared_ptr<word_index>& segment)
+{
+  std::vector<std::shared_ptr<const word_index>> segments = index->segments;
+  if (segments.empty() && !index->words->empty()) segments.push_back(index);
+
+  segment->first_id = segments.empty() ? 0 : segments.back()->first_id + segments.back()->words->size();
+  segments.push_back(segment);
+  while (segments.size() >= 2 && segments[segments.size()-2]->words->size() <= segments.back()->words->size())
+  {
+    auto merged = merge_segments(*segments[segments.size()-2], *segments.back());
+    segments.pop_back();
+    segments.back() = merged;
+  }
+  return segmented_index(index->key_length, std::move(segments));
+}
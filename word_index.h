@@ -0,0 +1,153 @@
+// Author: AwfulCrawler (2017)
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+struct word_entry
+{
+  std::string word;
+  uint32_t    quota;  //0 means no quota
+};
+
+//Lookup key (the first key_length characters of a word) -> ids into word_index::words
+typedef std::unordered_map<std::string, std::vector<uint32_t>> position_table;
+
+//------------------------------------------------------------------------------
+//
+//word_index holds one lookup table per start position, so a probe at a given
+//position only touches the words allowed there.  An index is never modified
+//once built; retiring words builds a new one that shares the word list.
+//
+//A streamed word list is indexed in segments instead, each with its own words
+//and tables.  The top index only lists them and their active positions.
+//Word ids run on from one segment to the next, a segment's tables hold ids
+//into its own words.
+//
+//------------------------------------------------------------------------------
+struct word_index
+{
+  uint32_t key_length;  //Length of the address substring used as the lookup key
+  size_t   word_count {0};
+  uint64_t source_hash {0};  //Of the word file or word it was built from, see hash_word_line
+  std::shared_ptr<const std::vector<word_entry>> words;
+  std::vector<position_table> positions;         //Indexed by start position
+  std::vector<uint32_t>       active_positions;  //Start positions with at least one word
+  uint32_t first_id {0};                         //Of a segment's first word
+  std::vector<std::shared_ptr<const word_index>> segments;  //Empty unless streamed
+};
+
+struct index_params
+{
+  uint32_t key_length;
+  uint32_t min_start_pos;  //Used for words without a position column
+  uint32_t max_start_pos;
+  uint32_t default_quota;
+  uint32_t max_position;   //Last start position with room for a key in the address, lines past it are rejected
+};
+
+//What load_word_file read
+struct word_file_stats
+{
+  uint64_t lines;
+  uint64_t words;       //Kept in the index
+  uint32_t threads;     //Used for the load
+  double   seconds;
+  bool     from_cache;  //Read from a compiled index, see index_cache.h
+};
+
+//A word list hashes to WORD_LIST_HASH_SEED folded with each line in turn:
+//hash * WORD_LIST_HASH_PRIME + FNV-1a of the line.  Unlike a plain FNV-1a of
+//the whole file, parts of the file can be hashed separately and combined.
+#define WORD_LIST_HASH_SEED  0xcbf29ce484222325ULL
+#define WORD_LIST_HASH_PRIME 0x100000001b3ULL
+uint64_t hash_word_line(uint64_t hash, const std::string& line);
+
+bool parse_word_line(const std::string& line, const index_params& params, word_entry& entry, std::vector<uint32_t>& positions);
+std::shared_ptr<word_index> without_words(const word_index& old_index, const std::unordered_set<std::string>& retiring);
+
+//A replica's copies of the segments and word lists of the index it copies,
+//keyed by the originals
+struct replica_parts
+{
+  std::map<std::shared_ptr<const word_index>, std::shared_ptr<const word_index>> segments;
+  std::map<std::shared_ptr<const std::vector<word_entry>>, std::shared_ptr<const std::vector<word_entry>>> words;
+};
+
+//A deep copy made by the calling thread.  Segments and word lists already in
+//parts are shared instead of copied again, so after a retirement or a new
+//stream segment only what changed is copied.  parts is left holding what the
+//copy uses.
+std::shared_ptr<const word_index> replicate_index(const std::shared_ptr<const word_index>& old_index, replica_parts& parts);
+
+size_t index_memory_bytes(const word_index& index);
+void set_active_positions(word_index& index);
+
+//The index itself, or the segments of a streamed list
+std::vector<const word_index*> index_parts(const word_index& index);
+
+//One segment of a streamed list from the whole lines in [begin, end)
+std::shared_ptr<word_index> parse_word_segment(const char* begin, const char* end, const index_params& params,
+                                               const std::function<bool(const word_entry&)>& skip, uint64_t& lines);
+
+//The index with the segment's words added after its own.  Segments of
+//similar size are merged, so a stream of n words is looked up in O(log n)
+//segments and each word is copied O(log n) times.
+std::shared_ptr<word_index> append_segment(const std::shared_ptr<const word_index>& index, const std::shared_ptr<word_index>& segment);
+
+//Builds an index from a word file, memory-mapped and parsed on up to
+//max_threads threads, each taking a chunk split on line boundaries.  Words
+//for which skip returns true are left out.  Returns nullptr if the file can't
+//be opened.
+std::shared_ptr<word_index> load_word_file(const std::string& filename, const index_params& params, uint32_t max_threads,
+                                           const std::function<bool(const word_entry&)>& skip, word_file_stats& stats);
+
+//The hash load_word_file would give the file, without parsing it
+bool hash_word_file(const std::string& filename, uint32_t max_threads, uint64_t& hash, uint64_t& lines);
+
+//------------------------------------------------------------------------------
+class word_index_builder
+{
+public:
+  word_index_builder(const index_params& a_params);
+
+  void add(const word_entry& entry, const std::vector<uint32_t>& positions);
+  std::shared_ptr<word_index> finish();
+
+private:
+  index_params params;
+  std::shared_ptr<std::vector<word_entry>> words;
+  std::shared_ptr<word_index> index;
+};